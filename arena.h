@@ -0,0 +1,130 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include<vector>
+#include<list>
+#include<deque>
+#include<set>
+#include<map>
+#include<new>
+#include<cstddef>
+using namespace std;
+
+// Memory for the container nodes of one simulation. Blocks come in power of two size classes from 16 to 4096
+// bytes, carved out of 64 KiB chunks and recycled through a free list per class, so a node freed on one time
+// step is reused by the next node of its size without going near the global allocator. Nothing is given back
+// until the arena is destroyed at the end of the run, then all of it goes at once. Anything bigger than the
+// largest class goes straight to the global allocator. Not thread safe, an arena belongs to one simulation
+class Arena
+{
+    public:
+      Arena() : m_next(nullptr), m_end(nullptr)
+      {
+        for(int c = 0; c < classCount; c++) {
+          m_free[c] = nullptr;
+        }
+      }
+
+      ~Arena()
+      {
+        for(size_t i = 0; i < m_chunks.size(); i++) {
+          ::operator delete(m_chunks[i]);
+        }
+      }
+
+      Arena(const Arena&) = delete;
+      Arena& operator=(const Arena&) = delete;
+
+      void* allocate(const size_t& bytes)
+      {
+        if(bytes > maxBlock) {
+          return ::operator new(bytes);
+        }
+        int c = classOf(bytes);
+        if(m_free[c] != nullptr) {
+          FreeBlock* block = m_free[c];
+          m_free[c] = block->next;
+          return block;
+        }
+        size_t size = minBlock << c;
+        if(size_t(m_end - m_next) < size) {
+          m_next = static_cast<char*>(::operator new(chunkSize));
+          m_end = m_next + chunkSize;
+          m_chunks.push_back(m_next);
+        }
+        void* block = m_next;
+        m_next += size;
+        return block;
+      }
+
+      // bytes has to be what the block was allocated with
+      void release(void* ptr, const size_t& bytes)
+      {
+        if(bytes > maxBlock) {
+          ::operator delete(ptr);
+          return;
+        }
+        int c = classOf(bytes);
+        FreeBlock* block = static_cast<FreeBlock*>(ptr);
+        block->next = m_free[c];
+        m_free[c] = block;
+      }
+
+      // Bytes taken from the global allocator for chunks so far
+      size_t reserved() const {return m_chunks.size() * chunkSize;}
+
+    private:
+      struct FreeBlock
+      {
+          FreeBlock* next;
+      };
+
+      static const size_t minBlock = 16;   // Every block keeps the alignment of operator new
+      static const size_t maxBlock = 4096;
+      static const int classCount = 9;
+      static const size_t chunkSize = 64 * 1024;
+
+      static int classOf(const size_t& bytes)
+      {
+        return bytes <= minBlock ? 0 : 64 - __builtin_clzll(bytes - 1) - 4;
+      }
+
+      FreeBlock* m_free[classCount];   // Free blocks of each size class
+      char* m_next;                     // Unused part of the newest chunk
+      char* m_end;
+      vector<char*> m_chunks;
+};
+
+// Standard allocator that takes its memory from an Arena, so the standard containers can use one
+template<class T>
+class PoolAllocator
+{
+    public:
+      typedef T value_type;
+
+      explicit PoolAllocator(Arena& arena) : m_arena(&arena) {}
+      template<class U> PoolAllocator(const PoolAllocator<U>& other) : m_arena(other.arena()) {}
+
+      T* allocate(size_t n) {return static_cast<T*>(m_arena->allocate(n * sizeof(T)));}
+      void deallocate(T* ptr, size_t n) {m_arena->release(ptr, n * sizeof(T));}
+
+      Arena* arena() const {return m_arena;}
+
+    private:
+      Arena* m_arena;
+};
+
+template<class T, class U>
+inline bool operator==(const PoolAllocator<T>& a, const PoolAllocator<U>& b) {return a.arena() == b.arena();}
+
+template<class T, class U>
+inline bool operator!=(const PoolAllocator<T>& a, const PoolAllocator<U>& b) {return a.arena() != b.arena();}
+
+// The containers the simulation keeps its nodes in, each made with a PoolAllocator of the simulation's arena
+template<class T> using PoolList = list<T, PoolAllocator<T> >;
+template<class T> using PoolDeque = deque<T, PoolAllocator<T> >;
+template<class T> using PoolSet = set<T, less<T>, PoolAllocator<T> >;
+template<class T> using PoolMultiset = multiset<T, less<T>, PoolAllocator<T> >;
+template<class K, class V> using PoolMap = map<K, V, less<K>, PoolAllocator<pair<const K, V> > >;
+
+#endif
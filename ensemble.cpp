@@ -0,0 +1,231 @@
+#include "ensemble.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+#include <mutex>
+
+// The end of run figures kept of each replica, everything else goes with its Metrics
+static const char* const figureNames[] = {"timeSteps", "turnaroundMean", "turnaroundP95", "responseMean", "responseP95",
+                                          "readyWaitMean", "cpuUtilization", "memoryUsedMean"};
+static const size_t figureCount = sizeof(figureNames) / sizeof(figureNames[0]);
+
+// What is kept of one replica: the figures above and the turnaround of every process, in the order they arrived
+struct Replica
+{
+    vector<double> figures;
+    vector<double> turnaround;
+};
+
+// The two sided 95% quantile of Student's t distribution with df degrees of freedom
+static double tQuantile(const int& df)
+{
+    static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                   2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                   2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+    if(df <= 30)
+    {
+        return table[df - 1];
+    }
+    // Cornish-Fisher expansion around the normal quantile, within 0.001 from here on
+    double z = 1.959964;
+    return z + (z * z * z + z) / (4.0 * df) + (5 * pow(z, 5) + 16 * pow(z, 3) + 3 * z) / (96.0 * df * df);
+}
+
+// Writes the row of the csv table for one figure, values holds it for every replica
+static void printInterval(ostream& out, const string& name, const vector<double>& values)
+{
+    size_t replicas = values.size();
+    double sum = 0, low = values[0], high = values[0];
+    for(size_t r = 0; r < replicas; r++)
+    {
+        sum += values[r];
+        low = min(low, values[r]);
+        high = max(high, values[r]);
+    }
+    double mean = sum / replicas;
+    double squares = 0;
+    for(size_t r = 0; r < replicas; r++)
+    {
+        squares += (values[r] - mean) * (values[r] - mean);
+    }
+
+    // a single replica has a mean but nothing to say how far off it could be
+    out << name << ',' << replicas << ',' << fixed << setprecision(4) << mean << ',';
+    if(replicas > 1)
+    {
+        double stddev = sqrt(squares / (replicas - 1));
+        double halfWidth = tQuantile(int(replicas) - 1) * stddev / sqrt(double(replicas));
+        out << stddev << ',' << mean - halfWidth << ',' << mean + halfWidth;
+    }
+    else
+    {
+        out << ",,";
+    }
+    out << ',' << low << ',' << high << endl;
+}
+
+// Runs the replicas in lanes, whose workloads are in workloads, in lockstep with the first of them as the
+// simulation, see ReplicaLanes, and fills in the ones that stayed in step to the end. Those that diverged are
+// left in lanes, the first one never does. Returns 0, or 1 if the first can't be run
+template<class Scheduler>
+static int runLockstepWith(const vector<const Workload*>& workloads, const SimConfig& config, vector<int>& lanes,
+                           vector<Replica>& replicas)
+{
+    vector<const Workload*> laneWorkloads;
+    for(size_t l = 0; l < lanes.size(); l++)
+    {
+        laneWorkloads.push_back(workloads[lanes[l]]);
+    }
+    ReplicaLanes replicaLanes(laneWorkloads, config.memory);
+    SummarySink sink;
+    Metrics metrics;
+    Simulator<Scheduler> simulator(*laneWorkloads[0], config, sink, &metrics);
+    simulator.runInStep(replicaLanes);
+    if(simulator.runToCompletion() != 0)
+    {
+        return 1;
+    }
+
+    // everything but the memory is the simulation's for a lane that stayed in step
+    vector<pair<string, MetricSummary> > summaries = metrics.summaries();
+    const vector<ProcessResult>& results = simulator.processTable().results;
+    vector<double> turnaround;
+    for(size_t r = 0; r < results.size(); r++)
+    {
+        turnaround.push_back(double(results[r].doneTime - results[r].arrivalTime));
+    }
+    vector<int> diverged;
+    for(size_t l = 0; l < lanes.size(); l++)
+    {
+        if(!replicaLanes.inStep(l))
+        {
+            diverged.push_back(lanes[l]);
+            continue;
+        }
+        double values[] = {double(metrics.time()), summaries[0].second.mean, double(summaries[0].second.p95), summaries[1].second.mean,
+                           double(summaries[1].second.p95), summaries[2].second.mean, metrics.cpuUtilization(), replicaLanes.usedMean(l)};
+        replicas[lanes[l]].figures.assign(values, values + figureCount);
+        replicas[lanes[l]].turnaround = turnaround;
+    }
+    lanes.swap(diverged);
+    return 0;
+}
+
+static int runLockstep(const vector<const Workload*>& workloads, const SimConfig& config, vector<int>& lanes,
+                       vector<Replica>& replicas)
+{
+    // each policy gets its own copy of the simulation loop, as in runSimulation
+    switch(config.sched.policy)
+    {
+        case mlfqPolicy:
+            return runLockstepWith<MLFQScheduler>(workloads, config, lanes, replicas);
+        case roundRobinPolicy:
+            return runLockstepWith<RoundRobinScheduler>(workloads, config, lanes, replicas);
+        case srtfPolicy:
+            return runLockstepWith<SRTFScheduler>(workloads, config, lanes, replicas);
+        case lotteryPolicy:
+            return runLockstepWith<LotteryScheduler>(workloads, config, lanes, replicas);
+        case stridePolicy:
+            return runLockstepWith<StrideScheduler>(workloads, config, lanes, replicas);
+    }
+    return 0;
+}
+
+int runEnsemble(const Workload& workload, const SimConfig& config, const unsigned int& seed, const int& replicas,
+                const int& threads, ostream& out)
+{
+    vector<Replica> kept(replicas);
+    vector<unique_ptr<Workload> > redrawn(replicas);
+    vector<const Workload*> workloads(replicas, &workload);
+
+    // the runs share cout, so they don't pace or report
+    SimConfig base(config);
+    base.sleepDuration = 0;
+    base.memReport = false;
+    base.printStats = false;
+
+    // The lottery draws from the replica's seed and a page fault depends on the size of the process, so with
+    // either one replica's schedule is its own from the start. Otherwise a thread takes replicas a group at a
+    // time and runs the group in lockstep, then the ones that diverged in lockstep again, until all have run
+    bool lockstep = config.sched.policy != lotteryPolicy && config.memory.allocator != pagedAllocator;
+    int groupCount = lockstep ? min(replicas, max(threads, 1)) : replicas;
+    vector<int> failed;
+
+    // every worker takes the next group nobody has taken yet, as in runSweep
+    atomic<int> next(0);
+    mutex failedLock;
+    auto worker = [&]()
+    {
+        for(int g = next++; g < groupCount; g = next++)
+        {
+            vector<int> lanes;
+            for(int r = g * replicas / groupCount; r < (g + 1) * replicas / groupCount; r++)
+            {
+                if(workload.seeded())
+                {
+                    redrawn[r].reset(new Workload());
+                    redrawn[r]->redraw(workload, seed + r);
+                    workloads[r] = redrawn[r].get();
+                }
+                lanes.push_back(r);
+            }
+            while(!lanes.empty())
+            {
+                SimConfig groupConfig(base);
+                groupConfig.sched.seed = seed + lanes[0];
+                if(runLockstep(workloads, groupConfig, lanes, kept) != 0)
+                {
+                    lock_guard<mutex> lock(failedLock);
+                    failed.push_back(lanes[0]);
+                    break;
+                }
+            }
+            for(int r = g * replicas / groupCount; r < (g + 1) * replicas / groupCount; r++)
+            {
+                redrawn[r].reset();
+            }
+        }
+    };
+
+    vector<thread> pool;
+    for(int t = 1; t < min(groupCount, max(threads, 1)); t++)
+    {
+        pool.push_back(thread(worker));
+    }
+    worker();
+    for(size_t t = 0; t < pool.size(); t++)
+    {
+        pool[t].join();
+    }
+
+    if(!failed.empty())
+    {
+        int r = *min_element(failed.begin(), failed.end());
+        cerr << "replica " << r << ", seed " << seed + r << ", failed" << endl;
+        return 1;
+    }
+
+    out << "figure,replicas,mean,stddev,ci95Low,ci95High,min,max" << endl;
+    vector<double> values(replicas);
+    for(size_t f = 0; f < figureCount; f++)
+    {
+        for(int r = 0; r < replicas; r++)
+        {
+            values[r] = kept[r].figures[f];
+        }
+        printInterval(out, figureNames[f], values);
+    }
+
+    // then the turnaround of each process, what the end of run "Wait Times" show, by the ID it arrived with
+    for(size_t i = 0; i < kept[0].turnaround.size(); i++)
+    {
+        for(int r = 0; r < replicas; r++)
+        {
+            values[r] = kept[r].turnaround[i];
+        }
+        printInterval(out, "turnaround." + to_string(workload.process(i).id), values);
+    }
+    return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include<iostream>
+using namespace std;
+
+#include "simulator.h"
+
+// Runs replicas replicas of the workload on config, spread over threads threads, and writes the mean of each
+// end of run figure over them with its 95% confidence interval to out as a csv table, followed by the same for
+// the turnaround of every process. Replica r is the run seed + r would have been, with the memoryRequired the
+// workload drew at random drawn again from that seed and the scheduler seeded with it, so replica 0 is the
+// single run with the same seed. Replicas whose memory gives the same schedule are simulated together, see
+// ReplicaLanes, the rest one by one. Only the processes are copied for a replica, the IO events are shared,
+// and per tick output is dropped. Returns 0, or 1 if a replica failed
+int runEnsemble(const Workload& workload, const SimConfig& config, const unsigned int& seed, const int& replicas,
+                const int& threads, ostream& out);
+
+#endif
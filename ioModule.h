@@ -2,46 +2,535 @@
 #define FIVE_STATE_IO_H
 
 #include<vector>
+#include<list>
+#include<string>
+#include<queue>       //for priority_queue
+#include<functional>  //for greater
+#include<atomic>
+#include<thread>
+#include<chrono>
+#include<cstdlib>     //for strtol
 using namespace std;
 
 #include "process.h"
+#include "spscRing.h"
+#include "arena.h"
+#include "snapshot.h"
+
+// Where IO requests are completed
+//   inlineIO     on the simulation thread, on exactly the time step they are due
+//   lockstepIO   on a device thread that the simulation waits for every time step, so interrupts arrive on
+//                the same time steps as inline, for regression runs of the threaded code
+//   realtimeIO   on a device thread that runs freely, interrupts arrive whenever the device gets to them
+enum IOMode { inlineIO, lockstepIO, realtimeIO };
+
+// Parses the name of an IO mode as given on the command line, returns false if it isn't one
+inline bool parseIOMode(const string& name, IOMode& mode)
+{
+    if(name == "inline") mode = inlineIO;
+    else if(name == "lockstep") mode = lockstepIO;
+    else if(name == "realtime") mode = realtimeIO;
+    else return false;
+    return true;
+}
+
+inline string ioModeName(const IOMode& mode)
+{
+    switch(mode)
+    {
+        case inlineIO:
+            return "inline";
+        case lockstepIO:
+            return "lockstep";
+        case realtimeIO:
+            return "realtime";
+    }
+    return "";
+}
+
+// The order a device serves the requests waiting for it in
+//   fifoOrder   the order they were submitted in
+//   sstfOrder   shortest service time first, ties in submission order. Workloads have no seek positions, so the
+//               service time stands in for the seek distance a disk would order by
+enum IOOrder { fifoOrder, sstfOrder };
+
+// A device IO requests go to. The default is the one device the simulator always had, which serves every request
+// as soon as it is made and takes the IO event's duration over it
+struct DeviceConfig
+{
+    DeviceConfig() : name("io"), depth(0), order(fifoOrder), serviceTime(0) {}
+
+    string name;
+    int depth;              // requests served at the same time, the rest wait, 0 for no limit
+    IOOrder order;
+    long serviceTime;       // time steps every request takes, 0 for the duration of its IO event
+};
+
+// Parses name[:depth[:fifo|sstf[:serviceTime]]] as given to --device, returns false if it isn't one
+inline bool parseDevice(const string& arg, DeviceConfig& device)
+{
+    device = DeviceConfig();
+    vector<string> parts;
+    size_t start = 0;
+    for(size_t colon = arg.find(':'); ; colon = arg.find(':', start))
+    {
+        parts.push_back(arg.substr(start, colon == string::npos ? string::npos : colon - start));
+        if(colon == string::npos)
+        {
+            break;
+        }
+        start = colon + 1;
+    }
+    if(parts.size() > 4 || parts[0].empty())
+    {
+        return false;
+    }
+    device.name = parts[0];
+
+    char* end;
+    if(parts.size() > 1)
+    {
+        device.depth = strtol(parts[1].c_str(), &end, 10);
+        if(parts[1].empty() || *end != '\0' || device.depth < 0)
+        {
+            return false;
+        }
+    }
+    if(parts.size() > 2)
+    {
+        if(parts[2] == "fifo") device.order = fifoOrder;
+        else if(parts[2] == "sstf") device.order = sstfOrder;
+        else return false;
+    }
+    if(parts.size() > 3)
+    {
+        device.serviceTime = strtol(parts[3].c_str(), &end, 10);
+        if(parts[3].empty() || *end != '\0' || device.serviceTime < 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// What a device did over a run
+struct DeviceStats
+{
+    DeviceStats() : completed(0), busyTicks(0), servedTicks(0), queueDelay(0), maxQueueDelay(0) {}
+
+    long completed;         // requests served
+    long busyTicks;         // time steps with at least one request in service
+    long servedTicks;       // the service time of every request served, more than busyTicks when they overlap
+    long queueDelay;        // time steps requests waited before their service began, all of them together
+    long maxQueueDelay;
+};
+
+// Nanoseconds on the monotonic clock, for timing interrupt delivery
+inline long long steadyNanos()
+{
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// The IO event id of the swap in a page fault waits for, see PagedMemory
+const unsigned int pageFaultEventID = 0xFFFFFFFF;
 
 struct IOInterrupt
 {
-    IOInterrupt() : ioEventID(99999), procID(99999) {};
-    IOInterrupt(const unsigned int& eId, const unsigned int& pId) : ioEventID(eId), procID(pId) {};
+    IOInterrupt() : ioEventID(99999), procID(99999), raisedAt(0) {};
+    IOInterrupt(const unsigned int& eId, const unsigned int& pId) : ioEventID(eId), procID(pId), raisedAt(0) {};
 
     unsigned int ioEventID;
-    unsigned int procID;
+    unsigned int procID;    // Process table index of the process that made the request
+    long long raisedAt;     // steadyNanos() when a device thread raised it, 0 inline
 };
 
+// Where interrupts wait for a processor to handle them
+typedef PoolList<IOInterrupt> InterruptList;
+
+// An outstanding IO request, ordered by completion time and then by the order it was submitted in
+struct IORequest
+{
+    IORequest() : doneTime(0), seq(0), submitted(0), service(0), device(0) {}
+    IORequest(const long& t, const unsigned long& s, const IOInterrupt& i) : doneTime(t), seq(s), interrupt(i), submitted(0), service(0), device(0) {}
+
+    bool operator>(const IORequest& other) const
+    {
+        return doneTime > other.doneTime || (doneTime == other.doneTime && seq > other.seq);
+    }
+
+    long doneTime;          // The time step the request completes on, once its service has begun
+    unsigned long seq;      // Submission counter, breaks ties between requests completing on the same time step
+    IOInterrupt interrupt;
+    long submitted;         // The time step it was submitted on
+    long service;           // Time steps of service it takes
+    uint32_t device;
+};
+
+// Orders the requests waiting for a device, the one it serves next on top
+struct WaitingOrder
+{
+    WaitingOrder(const IOOrder& o = fifoOrder) : order(o) {}
+
+    bool operator()(const IORequest& r1, const IORequest& r2) const
+    {
+        if(order == sstfOrder && r1.service != r2.service)
+        {
+            return r1.service > r2.service;
+        }
+        return r1.seq > r2.seq;
+    }
+
+    IOOrder order;
+};
+
+// Completes IO requests on the devices they go to. Inline, each device serves up to its depth of requests at once
+// and the rest wait for it in its order, so requests to a busy device see queueing delay. Completions are kept
+// in one heap by time and the waiting requests in one heap per device, nothing is scanned on a time step. A
+// device thread only models the default device
 class IOModule
 {
     public:
-      IOModule(list<IOInterrupt>& ioIntVec) : m_intVec(ioIntVec) {}
+      // devices are numbered in order, IOEvent::device picks one. No devices means just the default one
+      IOModule(InterruptList& ioIntVec, const IOMode& mode = inlineIO, const vector<DeviceConfig>& devices = vector<DeviceConfig>()) :
+          m_intVec(ioIntVec), m_mode(mode), m_submitted(0), m_waiting(0), m_requests(ringSize), m_completions(ringSize),
+          m_now(0), m_doneThrough(0), m_stop(false), m_ringFull(0), m_started(0), m_stopped(0)
+      {
+        for(size_t d = 0; d < max<size_t>(devices.size(), 1); d++) {
+          m_devices.push_back(Device(devices.empty() ? DeviceConfig() : devices[d]));
+        }
+        if(m_mode != inlineIO) {
+          m_started = steadyNanos();
+          m_device = thread(&IOModule::deviceLoop, this);
+        }
+      }
 
-      inline void ioProcessing(const int& curTimeStep)
+      ~IOModule() {stop();}
+
+      // The device thread uses the module, so it stays where it was made
+      IOModule(const IOModule&) = delete;
+      IOModule& operator=(const IOModule&) = delete;
+
+      // Raise an interrupt for every request that is complete by curTimeStep, in completion order with ties
+      // in the order the requests were submitted. A device that finishes a request starts on the next one
+      // waiting for it. Costs O(log n) per completion, nothing when none are due. With a device thread this
+      // tells it the time and collects what it raised, in lockstep it first waits for the device to finish
+      // with curTimeStep
+      inline void ioProcessing(const long& curTimeStep)
       {
-        for(int i = 0, i_end = m_pending.size(); i < i_end; ++i)
-        {
-            if(curTimeStep == m_pending[i].first)
-            {
-                m_intVec.push_back(m_pending[i].second);
-                m_pending.erase(m_pending.begin() + i);
-                --i;
-                --i_end;
-            }
+        if(m_mode == inlineIO) {
+          while(!m_pending.empty() && m_pending.top().doneTime <= curTimeStep)
+          {
+              IORequest request = m_pending.top();
+              m_pending.pop();
+              m_intVec.push_back(request.interrupt);
+              completed(request);
+          }
+          return;
+        }
+
+        m_now.store(curTimeStep, memory_order_release);
+        if(m_mode == lockstepIO) {
+          while(m_doneThrough.load(memory_order_acquire) < curTimeStep) {
+            collect(); // the device may be waiting for room in the ring
+            this_thread::yield();
+          }
+        }
+        collect();
+      }
+
+      // proc is the process table index of the process making the request, ioEvent.device has to be one of the
+      // devices
+      inline void submitIORequest(const long& curTimeStep, const IOEvent& ioEvent, const uint32_t& proc)
+      {
+        IORequest request(curTimeStep + ioEvent.duration, m_submitted, IOInterrupt(ioEvent.id, proc));
+        ++m_submitted;
+        if(m_mode != inlineIO) {
+          queue(request);
+          return;
+        }
+
+        Device& device = m_devices[ioEvent.device];
+        request.submitted = curTimeStep;
+        request.service = device.config.serviceTime > 0 ? device.config.serviceTime : ioEvent.duration;
+        request.device = ioEvent.device;
+        if(device.config.depth == 0 || device.inService < device.config.depth) {
+          start(request, curTimeStep);
+        } else {
+          device.waiting.push(request);
+          ++m_waiting;
+        }
+      }
+
+      // The time step of the earliest outstanding completion, or -1 if no IO is in flight
+      inline long nextCompletionTime() const
+      {
+        if(m_mode == inlineIO) {
+          return m_pending.empty() ? -1 : m_pending.top().doneTime;
+        }
+        return m_inFlight.empty() ? -1 : m_inFlight.top();
+      }
+
+      // Requests that haven't raised their interrupt yet, waiting for a device or in service
+      inline size_t pendingCount() const {return m_mode == inlineIO ? m_pending.size() + m_waiting : m_inFlight.size();}
+
+      size_t deviceCount() const {return m_devices.size();}
+      const DeviceConfig& device(const size_t& d) const {return m_devices[d].config;}
+
+      // Only kept inline
+      const DeviceStats& deviceStats(const size_t& d) const {return m_devices[d].stats;}
+
+      // Called when a processor handles an interrupt, to time its delivery
+      inline void handled(const IOInterrupt& interrupt)
+      {
+        if(interrupt.raisedAt != 0) {
+          m_latencies.push_back(steadyNanos() - interrupt.raisedAt);
+        }
+      }
+
+      // Stops the device thread, if there is one
+      void stop()
+      {
+        if(m_device.joinable()) {
+          m_stop.store(true, memory_order_release);
+          m_device.join();
+          m_stopped = steadyNanos();
         }
       }
 
-      inline void submitIORequest(const int& curTimeStep, const IOEvent& ioEvent, const Process& proc)
+      IOMode mode() const {return m_mode;}
+
+      // Raise to handle time of every interrupt handled, in nanoseconds
+      const vector<long>& latencies() const {return m_latencies;}
+
+      // Interrupts handled per second of wall time the device thread ran for
+      double handledPerSecond() const
       {
-        m_pending.push_back(make_pair(curTimeStep + ioEvent.duration, IOInterrupt(ioEvent.id, proc.id)));
+        return m_stopped > m_started ? m_latencies.size() * 1e9 / (m_stopped - m_started) : 0.0;
+      }
+
+      // Times a side found the ring it pushes to full and had to wait
+      long ringFull() const {return m_ringFull.load(memory_order_relaxed);}
+
+      // Writes the outstanding requests and the devices to a snapshot. Only inline, with a device thread they
+      // aren't all where this thread can see them
+      void save(SnapshotWriter& out) const
+      {
+        priority_queue<IORequest, vector<IORequest>, greater<IORequest> > pending(m_pending);
+        out.putUnsigned(m_submitted);
+        out.putUnsigned(pending.size());
+        for(; !pending.empty(); pending.pop()) {
+          out.put(pending.top().doneTime);
+          saveRequest(out, pending.top());
+        }
+
+        for(size_t d = 0; d < m_devices.size(); d++) {
+          const Device& device = m_devices[d];
+          out.put(device.busySince);
+          out.put(device.stats.completed);
+          out.put(device.stats.busyTicks);
+          out.put(device.stats.servedTicks);
+          out.put(device.stats.queueDelay);
+          out.put(device.stats.maxQueueDelay);
+          priority_queue<IORequest, vector<IORequest>, WaitingOrder> waiting(device.waiting);
+          out.putUnsigned(waiting.size());
+          for(; !waiting.empty(); waiting.pop()) {
+            saveRequest(out, waiting.top());
+          }
+        }
+      }
+
+      // Reads back what save wrote into a module that hasn't had any requests yet and has as many devices, in any
+      // mode. procCount is the size of the restored process table and time the time step the snapshot was taken
+      // on, a device resumed with more depth starts on what is waiting for it there. Returns false if the
+      // snapshot doesn't fit
+      bool load(SnapshotReader& in, const uint32_t& procCount, const long& time)
+      {
+        m_submitted = in.getUnsigned();
+        for(uint64_t n = in.getCount(); n > 0 && in.good(); n--) {
+          IORequest request;
+          request.doneTime = in.get();
+          if(loadRequest(in, request, procCount)) {
+            m_devices[request.device].inService++;
+            queue(request);
+          }
+        }
+
+        for(size_t d = 0; d < m_devices.size() && in.good(); d++) {
+          Device& device = m_devices[d];
+          device.busySince = in.get();
+          device.stats.completed = in.get();
+          device.stats.busyTicks = in.get();
+          device.stats.servedTicks = in.get();
+          device.stats.queueDelay = in.get();
+          device.stats.maxQueueDelay = in.get();
+          uint64_t n = in.getCount();
+          in.check(n == 0 || m_mode == inlineIO); // a device thread doesn't make requests wait
+          for(; n > 0 && in.good(); n--) {
+            IORequest request;
+            if(loadRequest(in, request, procCount) && in.check(request.device == d)) {
+              device.waiting.push(request);
+              ++m_waiting;
+            }
+          }
+          while(!device.waiting.empty() && (device.config.depth == 0 || device.inService < device.config.depth)) {
+            IORequest request = device.waiting.top();
+            device.waiting.pop();
+            --m_waiting;
+            start(request, time);
+          }
+        }
+        return in.good();
       }
 
     private:
-      list<IOInterrupt>& m_intVec;
-      vector<pair<int, IOInterrupt> > m_pending;
+      static const size_t ringSize = 1024;
+
+      // A device and the requests waiting for it, only used inline
+      struct Device
+      {
+          Device(const DeviceConfig& c) : config(c), inService(0), busySince(0), waiting(WaitingOrder(c.order)) {}
+
+          DeviceConfig config;
+          int inService;
+          long busySince;       // When it last went from idle to serving, while inService isn't 0
+          priority_queue<IORequest, vector<IORequest>, WaitingOrder> waiting;
+          DeviceStats stats;
+      };
+
+      // Begins serving request on its device at time
+      inline void start(IORequest& request, const long& time)
+      {
+        Device& device = m_devices[request.device];
+        if(device.inService++ == 0) {
+          device.busySince = time;
+        }
+        long delay = time - request.submitted;
+        device.stats.queueDelay += delay;
+        device.stats.maxQueueDelay = max(device.stats.maxQueueDelay, delay);
+        request.doneTime = time + request.service;
+        m_pending.push(request);
+      }
+
+      // The device of request is done with it, it goes on with the next one waiting, if there is one
+      inline void completed(const IORequest& request)
+      {
+        Device& device = m_devices[request.device];
+        device.stats.completed++;
+        device.stats.servedTicks += request.service;
+        if(--device.inService == 0) {
+          device.stats.busyTicks += request.doneTime - device.busySince;
+        }
+        if(!device.waiting.empty()) {
+          IORequest next = device.waiting.top();
+          device.waiting.pop();
+          --m_waiting;
+          start(next, request.doneTime);
+        }
+      }
+
+      // Everything but the completion time, which only a request in service has
+      static void saveRequest(SnapshotWriter& out, const IORequest& request)
+      {
+        out.putUnsigned(request.seq);
+        out.putUnsigned(request.interrupt.ioEventID);
+        out.putUnsigned(request.interrupt.procID);
+        out.put(request.submitted);
+        out.put(request.service);
+        out.putUnsigned(request.device);
+      }
+
+      bool loadRequest(SnapshotReader& in, IORequest& request, const uint32_t& procCount)
+      {
+        request.seq = in.getUnsigned();
+        request.interrupt.ioEventID = in.getUnsigned();
+        request.interrupt.procID = in.getIndex(procCount);
+        request.submitted = in.get();
+        request.service = in.get();
+        request.device = in.getIndex(m_devices.size());
+        return in.good();
+      }
+
+      // Hands a request to whoever completes it
+      inline void queue(const IORequest& request)
+      {
+        if(m_mode == inlineIO) {
+          m_pending.push(request);
+          return;
+        }
+
+        m_inFlight.push(request.doneTime);
+        while(!m_requests.push(request)) {
+          ++m_ringFull;
+          collect(); // the device may be waiting for room to raise an interrupt before it takes more requests
+          this_thread::yield();
+        }
+      }
+
+      // Simulation side, move what the device raised to the interrupt list
+      void collect()
+      {
+        IOInterrupt interrupt;
+        while(m_completions.pop(interrupt)) {
+          m_intVec.push_back(interrupt);
+          m_inFlight.pop(); // raised in completion order, so it's always the earliest one outstanding
+        }
+      }
+
+      // Device side, take the requests and, once the simulation moves on to a new time step, raise the
+      // interrupts that are due by then and tell it that time step is done
+      void deviceLoop()
+      {
+        long done = 0;
+        while(!m_stop.load(memory_order_acquire)) {
+          long now = m_now.load(memory_order_acquire); // everything submitted before this time step is in m_requests
+          IORequest request;
+          bool busy = false;
+          while(m_requests.pop(request)) {
+            m_pending.push(request);
+            busy = true;
+          }
+          if(now == done) {
+            if(!busy) {
+              this_thread::yield();
+            }
+            continue;
+          }
+          while(!m_pending.empty() && m_pending.top().doneTime <= now) {
+            IOInterrupt interrupt = m_pending.top().interrupt;
+            interrupt.raisedAt = steadyNanos();
+            while(!m_completions.push(interrupt)) {
+              if(m_stop.load(memory_order_acquire)) {
+                return;
+              }
+              ++m_ringFull;
+              this_thread::yield();
+            }
+            m_pending.pop();
+          }
+          done = now;
+          m_doneThrough.store(now, memory_order_release);
+        }
+      }
+
+      InterruptList& m_intVec;
+      const IOMode m_mode;
+      priority_queue<IORequest, vector<IORequest>, greater<IORequest> > m_pending; // Owned by the device thread if there is one
+      unsigned long m_submitted;
+      vector<Device> m_devices;
+      long m_waiting;                       // Requests waiting for a device, on all of them
+
+      // Only used with a device thread
+      SpscRing<IORequest> m_requests;       // Simulation to device
+      SpscRing<IOInterrupt> m_completions;  // Device to simulation
+      priority_queue<long, vector<long>, greater<long> > m_inFlight; // Completion times the simulation is waiting on
+      atomic<long> m_now;                   // The time step the simulation is at
+      atomic<long> m_doneThrough;           // The last time step the device has raised everything for
+      atomic<bool> m_stop;
+      atomic<long> m_ringFull;
+      vector<long> m_latencies;
+      long long m_started;
+      long long m_stopped;
+      thread m_device;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,173 @@
+#ifndef LEVEL_QUEUE_H
+#define LEVEL_QUEUE_H
+
+#include<vector>
+#include<cstdint>
+using namespace std;
+
+#include "process.h"
+
+// The set of levels that have anything on them. One bit per level, and a summary word with a bit for every
+// word of them that isn't zero, so the highest or the lowest level that is set takes two find first set
+// instructions however many levels there are. Holds up to maxLevels levels
+class LevelBitmap
+{
+    public:
+      static const int maxLevels = 64 * 64;
+
+      LevelBitmap() : m_summary(0) {}
+
+      // Makes room for levels 0 to levels - 1, the ones already set stay set
+      inline void resize(const int& levels) {m_bits.resize((levels + 63) / 64, 0);}
+
+      inline void set(const int& level)
+      {
+        m_bits[level >> 6] |= 1ULL << (level & 63);
+        m_summary |= 1ULL << (level >> 6);
+      }
+
+      inline void clear(const int& level)
+      {
+        m_bits[level >> 6] &= ~(1ULL << (level & 63));
+        if(m_bits[level >> 6] == 0) {
+          m_summary &= ~(1ULL << (level >> 6));
+        }
+      }
+
+      inline bool any() const {return m_summary != 0;}
+
+      // The highest and the lowest level that is set, only valid if any()
+      inline int highest() const
+      {
+        int word = 63 - __builtin_clzll(m_summary);
+        return word * 64 + 63 - __builtin_clzll(m_bits[word]);
+      }
+
+      inline int lowest() const
+      {
+        int word = __builtin_ctzll(m_summary);
+        return word * 64 + __builtin_ctzll(m_bits[word]);
+      }
+
+      inline void reset()
+      {
+        m_bits.assign(m_bits.size(), 0);
+        m_summary = 0;
+      }
+
+    private:
+      uint64_t m_summary;
+      vector<uint64_t> m_bits;
+};
+
+// A run queue with a FIFO on each level, for policies with dozens of priority levels. The FIFOs are linked
+// through ProcessTable::queueNext and queuePrev rather than nodes of their own, which works because a process is
+// on at most one processor's run queue at a time. Queueing, taking the front of the highest level or the back
+// of the lowest one and moving a whole level onto another are all O(1)
+class LevelQueue
+{
+    public:
+      LevelQueue(ProcessTable& procTable, const int& levels) :
+          m_procTable(procTable), m_head(levels, noProcess), m_tail(levels, noProcess), m_size(0)
+      {
+        m_levels.resize(levels);
+      }
+
+      inline void pushBack(const int& level, const uint32_t& p)
+      {
+        m_procTable.queuePrev[p] = m_tail[level];
+        m_procTable.queueNext[p] = noProcess;
+        if(m_tail[level] == noProcess) {
+          m_head[level] = p;
+          m_levels.set(level);
+        } else {
+          m_procTable.queueNext[m_tail[level]] = p;
+        }
+        m_tail[level] = p;
+        ++m_size;
+      }
+
+      // The front of the highest level that has anything on it, or noProcess
+      inline uint32_t popHighest()
+      {
+        if(!m_levels.any()) {
+          return noProcess;
+        }
+        int level = m_levels.highest();
+        uint32_t p = m_head[level];
+        m_head[level] = m_procTable.queueNext[p];
+        if(m_head[level] == noProcess) {
+          m_tail[level] = noProcess;
+          m_levels.clear(level);
+        } else {
+          m_procTable.queuePrev[m_head[level]] = noProcess;
+        }
+        unlinked(p);
+        return p;
+      }
+
+      // The back of the lowest level that has anything on it, or noProcess
+      inline uint32_t popLowest()
+      {
+        if(!m_levels.any()) {
+          return noProcess;
+        }
+        int level = m_levels.lowest();
+        uint32_t p = m_tail[level];
+        m_tail[level] = m_procTable.queuePrev[p];
+        if(m_tail[level] == noProcess) {
+          m_head[level] = noProcess;
+          m_levels.clear(level);
+        } else {
+          m_procTable.queueNext[m_tail[level]] = noProcess;
+        }
+        unlinked(p);
+        return p;
+      }
+
+      // Moves everything on level from to the back of level to, in order. Returns the first process moved, or
+      // noProcess if there was nothing, the rest follow it with next()
+      inline uint32_t moveAll(const int& from, const int& to)
+      {
+        uint32_t first = m_head[from];
+        if(first == noProcess) {
+          return noProcess;
+        }
+        m_procTable.queuePrev[first] = m_tail[to];
+        if(m_tail[to] == noProcess) {
+          m_head[to] = first;
+          m_levels.set(to);
+        } else {
+          m_procTable.queueNext[m_tail[to]] = first;
+        }
+        m_tail[to] = m_tail[from];
+        m_head[from] = m_tail[from] = noProcess;
+        m_levels.clear(from);
+        return first;
+      }
+
+      // Level front to back: for(p = front(level); p != noProcess; p = next(p))
+      inline uint32_t front(const int& level) const {return m_head[level];}
+      inline uint32_t next(const uint32_t& p) const {return m_procTable.queueNext[p];}
+
+      // p isn't on this or any other LevelQueue
+      inline bool unqueued(const uint32_t& p) const {return m_procTable.queueNext[p] == notQueued;}
+
+      inline bool empty() const {return m_size == 0;}
+      inline long size() const {return m_size;}
+
+    private:
+      inline void unlinked(const uint32_t& p)
+      {
+        m_procTable.queueNext[p] = m_procTable.queuePrev[p] = notQueued;
+        --m_size;
+      }
+
+      ProcessTable& m_procTable;
+      vector<uint32_t> m_head;    // First and last process on each level, noProcess if it is empty
+      vector<uint32_t> m_tail;
+      LevelBitmap m_levels;       // The levels that aren't empty
+      long m_size;
+};
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef LITTLE_ENDIAN_H
+#define LITTLE_ENDIAN_H
+
+#include<cstdint>
+using namespace std;
+
+// Stores the n low bytes of v at out, least significant byte first
+inline void putLittleEndian(char* out, uint64_t v, const int& n)
+{
+    for(int i = 0; i < n; i++, v >>= 8)
+    {
+        out[i] = char(v & 0xFF);
+    }
+}
+
+// Reads back n bytes stored by putLittleEndian
+inline uint64_t getLittleEndian(const char* in, const int& n)
+{
+    uint64_t v = 0;
+    for(int i = n - 1; i >= 0; i--)
+    {
+        v = v << 8 | uint8_t(in[i]);
+    }
+    return v;
+}
+
+#endif
@@ -1,333 +1,365 @@
-#include "process.h"
-#include "ioModule.h"
-#include "processMgmt.h"
-
-#include <chrono> // for sleep
-#include <thread> // for sleep
-
-#include <queue>
-
-// void transfer(list<Process> &processList, Process* runningPtr)  {
-//   for(auto& process : processList)  {
-//     if(process.id == runningPtr->id)  {
-//       process = *runningPtr;
-//       return;
-//     }
-//   }
-// }
-
-int main(int argc, char* argv[])
-{
-    // single thread processor
-    // it's either processing something or it's not
-//    bool processorAvailable = true;
-
-    // vector of processes, processes will appear here when they are created by
-    // the ProcessMgmt object (in other words, automatically at the appropriate time)
-    list<Process> processList;
-    
-    // this will orchestrate process creation in our system, it will add processes to 
-    // processList when they are created and ready to be run/managed
-    ProcessManagement processMgmt(processList);
-
-    // this is where interrupts will appear when the ioModule detects that an IO operation is complete
-    list<IOInterrupt> interrupts;   
-
-    // this manages io operations and will raise interrupts to signal io completion
-    IOModule ioModule(interrupts);  
-
-    // Do not touch
-    long time = 1;
-    long sleepDuration = 50;
-    string file;
-    stringstream ss;
-    enum stepActionEnum {noAct, admitNewProc, handleInterrupt, beginRun, continueRun, ioRequest, complete, endLevel} stepAction;
-
-    // Do not touch
-    switch(argc)
-    {
-        case 1:
-            file = "./procList.txt";  // default input file
-            break;
-        case 2:
-            file = argv[1];         // file given from command line
-            break;
-        case 3:
-            file = argv[1];         // file given
-            ss.str(argv[2]);        // sleep duration given
-            ss >> sleepDuration;
-            break;
-        default:
-            cerr << "incorrect number of command line arguments" << endl;
-            cout << "usage: " << argv[0] << " [file] [sleepDuration]" << endl;
-            return 1;
-            break;
-    }
-
-    processMgmt.readProcessFile(file);
-
-
-    time = 0;
-//    processorAvailable = true;
-    Process* runningProcess = nullptr; // Current Running Process
-    //list<Process*> readyList; // List of all ready processes in proper order
-    queue<Process*> highQueue;
-    queue<Process*> mediumQueue;
-    queue<Process*> lowQueue;
-    list<Process*> blockedList; // List of all blocked processes
-
-    // const int totalMemory = 1024;
-    int usedMemory = 0;
-    int timeQuantum[] = {16, 32, 64};
-    int memoryPartitions[] = {-1,-1,-1,-1}; // To be filled with process IDs (4 partitions of size 256bytes)
-    int usedMemoryPartitions = 0;
-
-
-    //keep running the loop until all processes have been added and have run to completion
-    while(processMgmt.moreProcessesComing() || !highQueue.empty() ||!mediumQueue.empty() ||!lowQueue.empty() || !blockedList.empty() || runningProcess) /* TODO add something to keep going as long as there are processes that arent done! */ 
-    {
-        //Update our current time step
-        ++time;
-
-        //let new processes in if there are any
-        processMgmt.activateProcesses(time);
-
-        //update the status for any active IO requests
-        ioModule.ioProcessing(time);
-
-        //If the processor is tied up running a process, then continue running it until it is done or blocks
-        //   note: be sure to check for things that should happen as the process continues to run (io, completion...)
-        //If the processor is free then you can choose the appropriate action to take, the choices (in order of precedence) are:
-        // - admit a new process if one is ready (i.e., take a 'newArrival' process and put them in the 'ready' state)
-        // - address an interrupt if there are any pending (i.e., update the state of a blocked process whose IO operation is complete)
-        // - start processing a ready process if there are any ready
-
-
-        //init the stepAction, update below
-        stepAction = noAct;
-
-        
-        //TODO add in the code to take an appropriate action for this time step!
-        //you should set the action variable based on what you do this time step. you can just copy and paste the lines below and uncomment them, if you want.
-        //stepAction = continueRun;  //runnning process is still running
-        //stepAction = ioRequest;  //running process issued an io request
-        //stepAction = complete;   //running process is finished
-        //stepAction = admitNewProc;   //admit a new process into 'ready'
-        //stepAction = handleInterrupt;   //handle an interrupt
-        //stepAction = beginRun;   //start running a process
-        
-
-        //   <your code here> 
-        if(runningProcess)  { // Is there a process currently running? ---Yes
-          int quantum = timeQuantum[3 - runningProcess->level];
-          runningProcess->processorTime++; // Update processor Time
-          runningProcess->timeUsedThisQuantum++;
-          if(!runningProcess->ioEvents.empty() && runningProcess->ioEvents.front().time == runningProcess->processorTime) {  // Does the running process have an I/O Event? ---Yes
-            ioModule.submitIORequest(time, runningProcess->ioEvents.front(), *runningProcess);  // I/O Request
-            runningProcess->ioEvents.pop_front();
-            runningProcess->state = blocked; // Block Process
-            blockedList.push_back(runningProcess); // Add to block list
-            stepAction = ioRequest;
-          } else if(runningProcess->processorTime >= runningProcess->reqProcessorTime) { // ---No--- Has the running process run long enough? ---Yes
-            runningProcess->state = done;
-            runningProcess->doneTime = time;
-            stepAction = complete;
-          } else if(runningProcess->timeUsedThisQuantum >= quantum) { // ---No--- Has the running process run long enough in the level but not done? ---Yes
-            if(runningProcess->level > 1) {
-              runningProcess->level--;
-            }
-            runningProcess->state = ready;
-            switch(runningProcess->level) {
-              case 2: mediumQueue.push(runningProcess); break;
-              case 1: lowQueue.push(runningProcess); break;
-            }
-            stepAction = endLevel;
-            runningProcess->timeUsedThisQuantum = 0;
-            //transfer(processList, runningProcess);
-            runningProcess = nullptr; // If end of level, keep memory allocated
-          } else{ //--- No
-            stepAction = continueRun;
-          }
-          if(stepAction == ioRequest || stepAction == complete) { // If process is blocked or done running completely then deallocate memory
-            usedMemory -= runningProcess->memoryRequired;
-            for(int i = 0; i < 4; i++)  { // Finds memory partition and removes it
-              if(memoryPartitions[i] == int(runningProcess->id)) {
-                memoryPartitions[i] = -1;
-                usedMemoryPartitions--;
-                break;
-              } else if (i == 3)  { // Error, memory partition not found
-                cout << "Error, memory partition not found" << endl;
-              }
-            }
-            //transfer(processList, runningProcess);
-            runningProcess = nullptr;
-          }
-        } else  { // ---No process running
-          for(auto& process : processList)  { // Are there any new Arrivals? ---Yes
-            if(process.state == newArrival) {
-              if(usedMemoryPartitions < 4)  { // Is there memory available? ---Yes
-                process.state = ready;
-                highQueue.push(&process); // add to High queue
-                usedMemory += process.memoryRequired; // Allocate memory
-                usedMemoryPartitions++;
-                for(int i = 0; i< 4; i++){
-                  if(memoryPartitions[i] == -1){
-                    memoryPartitions[i] = process.id;
-                    break;
-                  }
-                } 
-                stepAction = admitNewProc;
-                break;
-              } else { // Is there memory available? ---No
-                highQueue.push(&process); // add to High queue
-                process.state = memBlocked;
-                stepAction = admitNewProc;
-                break;
-              }
-            }
-          } // If there is a new arrival, then we skip the next statements
-
-          if(!interrupts.empty() && stepAction != admitNewProc) { // ---No--- Are there any pending interrupts? ---Yes
-            IOInterrupt interrupt = interrupts.front();
-            interrupts.pop_front(); //Removes interrupt
-
-            for (auto it = blockedList.begin(); it != blockedList.end(); ) {  // Checks block list for correct process
-              // if((*it)->id == interrupt.procID && (*it)->state == done) { // Checks if interrupt is calling for process that has already completed.
-              //   cout << "Process already done; Interrupt" << endl;
-              //   stepAction = handleInterrupt;
-              //   runningProcess = nullptr;
-              //   break;
-              // }
-              if ((*it)->id == interrupt.procID) {  // Found process and is not done
-                if(usedMemoryPartitions < 4) { // Is there memory available? ---Yes
-                  (*it)->state = ready;
-                  usedMemory += (*it)->memoryRequired;
-                  for(int i = 0; i < 4; i++) {
-                    if(memoryPartitions[i] == -1) {
-                      memoryPartitions[i] = (*it)->id;
-                      usedMemoryPartitions++;
-                      break;
-                    }
-                  }
-                } else { // No
-                  (*it)->state = memBlocked;
-                }
-                switch((*it)->level) { // Regardless of Memory availability, put process back into queue
-                  case 3: highQueue.push(*it); break;
-                  case 2: mediumQueue.push(*it); break;
-                  case 1: lowQueue.push(*it); break;
-                }
-                it = blockedList.erase(it); // erases process from blocked list
-                stepAction = handleInterrupt;
-                break;
-              } else {  
-                ++it;  
-              }  
-            }  
-          } else if(stepAction != admitNewProc) { // ---No--- Are there any processes in the ready Queues? ---Yes
-            if(runningProcess == nullptr) {
-              if (!highQueue.empty()) {
-                runningProcess = highQueue.front();
-                highQueue.pop();
-              } else if (!mediumQueue.empty()) {
-                runningProcess = mediumQueue.front();
-                mediumQueue.pop();
-              } else if (!lowQueue.empty()) {
-                runningProcess = lowQueue.front();
-                lowQueue.pop();
-              }
-              if (runningProcess) {
-                if (runningProcess->state == memBlocked) { // Is memory allocated to this process? ---No
-                  if (usedMemoryPartitions < 4)  { // Is there available memory now? ---Yes
-                    usedMemory += runningProcess->memoryRequired; // Allocate memory 
-                    for(int i = 0; i < 4; i++)  {
-                      if(memoryPartitions[i] == -1) { // Found open partition
-                        memoryPartitions[i] = runningProcess->id;
-                        usedMemoryPartitions++;
-                        break;
-                      } else if (i == 3)  { // Error, open memory partition not found
-                        cout << "Error, empty memory not found" << endl;
-                      }
-                    }
-                  } else { // ---No, find lowest priority process to take memory from.
-                    Process* lowProcess = nullptr;
-                    for(auto& process : processList)  { // find lowest priority process and set lowProcess pointer to it
-                      if(process.state == ready)  {
-                        if(lowProcess == nullptr) {
-                          lowProcess = &process;
-                        } else if(process.level < lowProcess->level) {
-                          lowProcess = &process;
-                        }
-                      }
-                    }
-                    lowProcess->state = memBlocked; // Deallocate memory
-                    usedMemory -= lowProcess->memoryRequired;
-                    usedMemoryPartitions--;
-                    for(int i = 0; i < 4; i++)  { // Finds memory partition and swaps
-                      if(memoryPartitions[i] == int(lowProcess->id)) { // Found lowPriority process's partition
-                        memoryPartitions[i] = runningProcess->id;
-                        usedMemoryPartitions++;
-                        usedMemory += runningProcess->memoryRequired;
-                        break;
-                      } else if (i == 3)  { // Error, open memory partition not found
-                        cout << "Error, memory not found" << endl;
-                      }
-                    }
-                  }
-                } // ---Yes, Continue
-                runningProcess->state = processing;
-                stepAction = beginRun;
-              }
-            }
-          }
-        }
-        // Leave the below alone (at least for final submission, we are counting on the output being in expected format)
-        cout << setw(5) << time << "\t"; 
-        
-        switch(stepAction)
-        {
-            case admitNewProc:
-              cout << "[   admit]\t";
-              break;
-            case handleInterrupt:
-              cout << "[  inrtpt]\t";
-              break;
-            case beginRun:
-              cout << "[   begin]\t";
-              break;
-            case continueRun:
-              cout << "[ contRun]\t";
-              break;
-            case ioRequest:
-              cout << "[   ioReq]\t";
-              break;
-            case complete:
-              cout << "[  finish]\t";
-              break;
-            case noAct:
-              cout << "[ *noAct*]\t";
-              break;
-            case endLevel:
-              cout << "[endLevel]\t";
-              break;
-        }
-
-        // You may wish to use a second vector of processes (you don't need to, but you can)
-        printProcessStates(processList); // change processList to another vector of processes if desired
-        cout << "Memory Partitions:" << usedMemoryPartitions << " [ ";
-        for (int i = 0; i < 4; i++) {cout << memoryPartitions[i] << ' '; } 
-        cout << "] usedMem:" << usedMemory << " processlvl:";
-        if(runningProcess) {cout << runningProcess->level << " runningID:";}
-        if(runningProcess) {cout << runningProcess->id << " Mem:";}
-        if(runningProcess) {cout << runningProcess->memoryRequired;}
-        cout << " Internal Fragmentation:" << usedMemoryPartitions * 256 - usedMemory << endl;
-        this_thread::sleep_for(chrono::milliseconds(sleepDuration));
-    }
-
-    cout << "Wait Times:" << endl;
-    for( auto& process : processList) {
-      cout << "Process ID: " << process.id << ", time: " << process.doneTime - process.arrivalTime << " time ticks" << endl;
-    }
-
-    return 0;
-}
+#include "simulator.h"
+#include "sweep.h"
+#include "ensemble.h"
+
+int main(int argc, char* argv[])
+{
+    SimConfig config; // no pacing unless a sleep duration is given, memory is summarized whenever it is configured
+    string file;
+    stringstream ss;
+    bool collectMetrics = false;
+    MetricsFormat metricsFormat = humanMetrics;
+    string metricsFile; // metrics go to cout unless a file is given
+    Output output = textOutput;
+    string traceFile = "trace.bin"; // where the binary and delta sinks write their logs
+    vector<SweepAxis> sweep; // parameters to run every combination of, instead of a single run
+    int threads = thread::hardware_concurrency();
+    int replicas = 0; // runs of the workload with seeds from seed on, summarized together, instead of a single run
+    string followFile; // more processes, read while the simulation runs, "-" for stdin
+    RunOptions options; // snapshots to resume from and save to
+    bool saveAtGiven = false;
+    unsigned int seed = random_device()(); // seed for the random parts of the workload
+    vector<string> args;
+
+    for(int i = 1; i < argc; i++)
+    {
+        string arg(argv[i]);
+        if(arg == "-e" || arg == "--event")
+        {
+            config.eventDriven = true;
+        }
+        else if((arg == "-s" || arg == "--seed") && i + 1 < argc)
+        {
+            seed = strtoul(argv[++i], nullptr, 10);
+        }
+        else if((arg == "-p" || arg == "--policy") && i + 1 < argc)
+        {
+            if(!parsePolicy(argv[++i], config.sched.policy))
+            {
+                cerr << "unknown scheduling policy \"" << argv[i] << "\", use mlfq, rr, srtf, lottery or stride" << endl;
+                return 1;
+            }
+        }
+        else if(arg == "--levels" && i + 1 < argc)
+        {
+            config.sched.levels = strtol(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--quanta" && i + 1 < argc)
+        {
+            parseQuanta(argv[++i], config.sched.quanta);
+        }
+        else if(arg == "--boost" && i + 1 < argc)
+        {
+            config.sched.boostPeriod = strtol(argv[++i], nullptr, 10);
+        }
+        else if((arg == "-c" || arg == "--cpus") && i + 1 < argc)
+        {
+            config.cpuCount = strtol(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--tickets" && i + 1 < argc)
+        {
+            config.sched.tickets = strtol(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--io" && i + 1 < argc)
+        {
+            if(!parseIOMode(argv[++i], config.ioMode))
+            {
+                cerr << "unknown IO mode \"" << argv[i] << "\", use inline, lockstep or realtime" << endl;
+                return 1;
+            }
+        }
+        else if(arg == "--device" && i + 1 < argc)
+        {
+            DeviceConfig device;
+            if(!parseDevice(argv[++i], device))
+            {
+                cerr << "invalid device \"" << argv[i] << "\", use name[:depth[:fifo|sstf[:serviceTime]]]" << endl;
+                return 1;
+            }
+            config.devices.push_back(device);
+        }
+        else if((arg == "-o" || arg == "--output") && i + 1 < argc)
+        {
+            if(!parseOutput(argv[++i], output))
+            {
+                cerr << "unknown output \"" << argv[i] << "\", use text, binary, delta or summary" << endl;
+                return 1;
+            }
+        }
+        else if(arg == "--metrics" && i + 1 < argc)
+        {
+            if(!parseMetricsFormat(argv[++i], metricsFormat))
+            {
+                cerr << "unknown metrics format \"" << argv[i] << "\", use human, csv or json" << endl;
+                return 1;
+            }
+            collectMetrics = true;
+        }
+        else if(arg == "--metrics-file" && i + 1 < argc)
+        {
+            metricsFile = argv[++i];
+            collectMetrics = true;
+        }
+        else if(arg == "--stats")
+        {
+            config.printStats = true;
+        }
+        else if(arg == "--trace-file" && i + 1 < argc)
+        {
+            traceFile = argv[++i];
+        }
+        else if((arg == "-m" || arg == "--memory") && i + 1 < argc)
+        {
+            if(!parseAllocator(argv[++i], config.memory.allocator))
+            {
+                cerr << "unknown memory allocator \"" << argv[i] << "\", use partitions, buddy, first-fit, best-fit or paged" << endl;
+                return 1;
+            }
+            config.memReport = true;
+        }
+        else if(arg == "--mem-size" && i + 1 < argc)
+        {
+            config.memory.totalMemory = strtol(argv[++i], nullptr, 10);
+            config.memReport = true;
+        }
+        else if(arg == "--partitions" && i + 1 < argc)
+        {
+            config.memory.partitions = strtol(argv[++i], nullptr, 10);
+            config.memReport = true;
+        }
+        else if(arg == "--min-block" && i + 1 < argc)
+        {
+            config.memory.minBlock = strtol(argv[++i], nullptr, 10);
+            config.memReport = true;
+        }
+        else if(arg == "--page-size" && i + 1 < argc)
+        {
+            config.memory.pageSize = strtol(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--replacement" && i + 1 < argc)
+        {
+            if(!parseReplacement(argv[++i], config.memory.replacement))
+            {
+                cerr << "unknown page replacement policy \"" << argv[i] << "\", use lru, clock or 2q" << endl;
+                return 1;
+            }
+        }
+        else if(arg == "--working-set" && i + 1 < argc)
+        {
+            config.memory.workingSet = strtol(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--swap-time" && i + 1 < argc)
+        {
+            config.memory.swapTime = strtol(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--swap-device" && i + 1 < argc)
+        {
+            config.memory.swapDevice = strtoul(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--sweep" && i + 1 < argc)
+        {
+            SweepAxis axis;
+            if(!parseSweepAxis(argv[++i], axis))
+            {
+                cerr << "invalid sweep \"" << argv[i] << "\", use name=value/value/... with policy, levels, quanta, boost, tickets," << endl;
+                cerr << "cpus, memory, mem-size, partitions or min-block" << endl;
+                return 1;
+            }
+            sweep.push_back(axis);
+        }
+        else if(arg == "--replicas" && i + 1 < argc)
+        {
+            replicas = strtol(argv[++i], nullptr, 10);
+            if(replicas < 1)
+            {
+                cerr << "there has to be at least one replica" << endl;
+                return 1;
+            }
+        }
+        else if(arg == "--threads" && i + 1 < argc)
+        {
+            threads = strtol(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--follow" && i + 1 < argc)
+        {
+            followFile = argv[++i];
+        }
+        else if(arg == "--resume" && i + 1 < argc)
+        {
+            options.resumeFrom = argv[++i];
+        }
+        else if(arg == "--save" && i + 1 < argc)
+        {
+            options.saveTo = argv[++i];
+        }
+        else if(arg == "--save-at" && i + 1 < argc)
+        {
+            options.saveAt = strtol(argv[++i], nullptr, 10);
+            saveAtGiven = true;
+        }
+        else if(arg == "--stop-after-save")
+        {
+            options.stopAfterSave = true;
+        }
+        else if(arg == "--profile-file" && i + 1 < argc)
+        {
+            options.profileFile = argv[++i];
+        }
+        else
+        {
+            args.push_back(arg);
+        }
+    }
+
+    // Do not touch
+    switch(args.size())
+    {
+        case 0:
+            file = "./procList.txt";  // default input file
+            break;
+        case 1:
+            file = args[0];         // file given from command line
+            break;
+        case 2:
+            file = args[0];         // file given
+            ss.str(args[1]);        // sleep duration given
+            ss >> config.sleepDuration;
+            break;
+        default:
+            cerr << "incorrect number of command line arguments" << endl;
+            cout << "usage: " << argv[0] << " [-e|--event] [-s|--seed seed] [-p|--policy mlfq|rr|srtf|lottery|stride]" << endl;
+            cout << "       [--levels n] [--quanta q1,q2,...] [--boost period] [--tickets n] [-c|--cpus n]" << endl;
+            cout << "       [--io inline|lockstep|realtime] [--device name[:depth[:fifo|sstf[:serviceTime]]]]..." << endl;
+            cout << "       [-m|--memory partitions|buddy|first-fit|best-fit|paged] [--mem-size bytes] [--partitions n] [--min-block bytes]" << endl;
+            cout << "       [--page-size bytes] [--replacement lru|clock|2q] [--working-set pages] [--swap-time t] [--swap-device n]" << endl;
+            cout << "       [-o|--output text|binary|delta|summary] [--trace-file file] [--stats]" << endl;
+            cout << "       [--metrics human|csv|json] [--metrics-file file]" << endl;
+            cout << "       [--sweep name=v1/v2/...]... [--replicas n] [--threads n] [--follow file|-]" << endl;
+            cout << "       [--resume snapshot] [--save snapshot --save-at time [--stop-after-save]] [--profile-file file]" << endl;
+            cout << "       [file] [sleepDuration]" << endl;
+            return 1;
+            break;
+    }
+
+    config.sched.seed = seed;
+    string problem = checkConfig(config);
+    if(!problem.empty())
+    {
+        cerr << problem << endl;
+        return 1;
+    }
+    if(threads < 1)
+    {
+        cerr << "there has to be at least one thread" << endl;
+        return 1;
+    }
+    if((!followFile.empty() || !options.saveTo.empty()) && (!sweep.empty() || replicas > 0))
+    {
+        cerr << "--follow and --save can only be used for a single run" << endl;
+        return 1;
+    }
+    if(replicas > 0 && (!sweep.empty() || !options.resumeFrom.empty()))
+    {
+        cerr << "--replicas can't be combined with --sweep or --resume" << endl;
+        return 1;
+    }
+    if(!options.profileFile.empty() && !Profiler::enabled)
+    {
+        cerr << "this build isn't instrumented, build it with make profile for --profile-file" << endl;
+        return 1;
+    }
+    if(options.saveTo.empty() != !saveAtGiven)
+    {
+        cerr << "--save and --save-at go together" << endl;
+        return 1;
+    }
+
+    // cout is only used through iostreams, so it doesn't need to keep in step with stdio
+    ios::sync_with_stdio(false);
+
+    // read or mapped once, every run only reads it. A single run of a file that can't be read has nothing to simulate
+    Workload workload;
+    bool loaded = openWorkloadFile(file, seed, workload);
+    if(!sweep.empty())
+    {
+        return loaded ? runSweep(workload, config, sweep, threads, cout, options.resumeFrom) : 1;
+    }
+    if(replicas > 0)
+    {
+        return loaded ? runEnsemble(workload, config, seed, replicas, threads, cout) : 1;
+    }
+
+    unique_ptr<TraceSink> sink;
+    switch(output)
+    {
+        case textOutput:
+            sink.reset(new TextSink(config.memory.allocator != partitionAllocator));
+            break;
+        case binaryOutput:
+        case deltaOutput:
+        {
+            FileSink* fileSink;
+            if(output == binaryOutput)
+            {
+                fileSink = new BinarySink(traceFile);
+            }
+            else
+            {
+                fileSink = new DeltaSink(traceFile, config.cpuCount);
+            }
+            sink.reset(fileSink);
+            if(!fileSink->good())
+            {
+                cerr << "unable to open trace file \"" << traceFile << "\"" << endl;
+                return 1;
+            }
+            break;
+        }
+        case summaryOutput:
+            sink.reset(new SummarySink());
+            break;
+    }
+
+    // processes read from a pipe or a file that is still being written arrive on top of the workload's, numbered after them
+    unique_ptr<ArrivalFeed> feed;
+    ifstream followIn;
+    if(!followFile.empty())
+    {
+        if(followFile != "-")
+        {
+            followIn.open(followFile.c_str());
+            if(!followIn.good())
+            {
+                cerr << "unable to open \"" << followFile << "\"" << endl;
+                return 1;
+            }
+        }
+        feed.reset(new ArrivalFeed(followFile == "-" ? cin : followIn, seed + 1, workload.size(), workload.ioEventCount()));
+        options.feed = feed.get();
+    }
+
+    Metrics metrics;
+    Metrics* metricsPtr = collectMetrics ? &metrics : nullptr;
+
+    int status = runSimulation(workload, config, *sink, metricsPtr, true, options);
+
+    if(status == 0 && collectMetrics && !options.stopAfterSave) // a run stopped after saving is carried on elsewhere
+    {
+        if(metricsFile.empty())
+        {
+            metrics.print(cout, metricsFormat);
+        }
+        else
+        {
+            ofstream out(metricsFile.c_str());
+            metrics.print(out, metricsFormat);
+            if(!out.good())
+            {
+                cerr << "unable to write metrics to \"" << metricsFile << "\"" << endl;
+                return 1;
+            }
+        }
+    }
+
+    return status;
+}
@@ -0,0 +1,1350 @@
+#include "memory.h"
+
+#include <iomanip>
+#include <algorithm>
+
+// splitmix64's finalizer. The paged model's references are a function of the process and how long it has run so
+// they come out the same whatever else is going on, on a resumed run too, and treap priorities are one of the offset
+static inline uint64_t mix(uint64_t x)
+{
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+bool parseAllocator(const string& name, Allocator& allocator)
+{
+    if(name == "partitions")
+    {
+        allocator = partitionAllocator;
+    }
+    else if(name == "buddy")
+    {
+        allocator = buddyAllocator;
+    }
+    else if(name == "first-fit")
+    {
+        allocator = firstFitAllocator;
+    }
+    else if(name == "best-fit")
+    {
+        allocator = bestFitAllocator;
+    }
+    else if(name == "paged")
+    {
+        allocator = pagedAllocator;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+string allocatorName(const Allocator& allocator)
+{
+    switch(allocator)
+    {
+        case buddyAllocator:
+            return "buddy";
+        case firstFitAllocator:
+            return "first-fit";
+        case bestFitAllocator:
+            return "best-fit";
+        case pagedAllocator:
+            return "paged";
+        case partitionAllocator:
+        default:
+            return "partitions";
+    }
+}
+
+bool parseReplacement(const string& name, Replacement& replacement)
+{
+    if(name == "lru")
+    {
+        replacement = lruReplacement;
+    }
+    else if(name == "clock")
+    {
+        replacement = clockReplacement;
+    }
+    else if(name == "2q")
+    {
+        replacement = twoQReplacement;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+string replacementName(const Replacement& replacement)
+{
+    switch(replacement)
+    {
+        case clockReplacement:
+            return "clock";
+        case twoQReplacement:
+            return "2q";
+        case lruReplacement:
+        default:
+            return "lru";
+    }
+}
+
+MemoryAllocator::MemoryAllocator(const long& totalMemory) :
+    m_totalMemory(totalMemory), m_used(0), m_reserved(0), m_resident(0), m_allocations(0), m_failures(0),
+    m_evictions(0), m_peakResident(0), m_lastTime(1), m_residentTicks(0), m_internalTicks(0), m_externalTicks(0)
+{
+}
+
+bool MemoryAllocator::allocate(const uint32_t& p, const long& size)
+{
+    long got = doAllocate(p, size);
+    if(got == 0)
+    {
+        m_failures++;
+        return false;
+    }
+
+    if(p >= m_size.size())
+    {
+        m_size.resize(p + 1, 0);
+    }
+    m_size[p] = size;
+    m_used += size;
+    m_reserved += got;
+    m_resident++;
+    m_allocations++;
+    m_peakResident = max(m_peakResident, m_resident);
+    return true;
+}
+
+bool MemoryAllocator::release(const uint32_t& p)
+{
+    long had = doRelease(p);
+    if(had == 0)
+    {
+        return false;
+    }
+
+    m_used -= m_size[p];
+    m_reserved -= had;
+    m_resident--;
+    return true;
+}
+
+bool MemoryAllocator::evict(const uint32_t& p)
+{
+    if(!release(p))
+    {
+        return false;
+    }
+    m_evictions++;
+    return true;
+}
+
+void MemoryAllocator::account(const long& time)
+{
+    // the state as it is now has lasted since the previous call
+    long ticks = time - m_lastTime;
+    m_residentTicks += m_resident * ticks;
+    m_internalTicks += internalFragmentation() * ticks;
+    m_externalTicks += externalFragmentation() * ticks;
+    m_lastTime = time;
+}
+
+void MemoryAllocator::printReport(const string& name) const
+{
+    double ticks = m_lastTime > 1 ? m_lastTime - 1 : 1; // time steps accounted for
+    cout << "Memory:" << endl;
+    cout << name << " allocator, " << m_totalMemory << " bytes" << endl;
+    cout << "allocations " << m_allocations << ", refused " << m_failures << ", evictions " << m_evictions
+         << ", admission rate " << fixed << setprecision(4) << m_allocations / ticks << " per time step" << endl;
+    cout << "resident processes: peak " << m_peakResident << ", mean " << setprecision(2) << m_residentTicks / ticks << endl;
+    cout << "mean internal fragmentation " << m_internalTicks / ticks << " bytes, mean external fragmentation "
+         << m_externalTicks / ticks << " bytes" << endl;
+}
+
+void MemoryAllocator::save(SnapshotWriter& out) const
+{
+    out.putUnsigned(m_size.size());
+    for(size_t p = 0; p < m_size.size(); p++)
+    {
+        out.put(m_size[p]);
+    }
+    long counters[] = {m_used, m_reserved, m_resident, m_allocations, m_failures, m_evictions, m_peakResident,
+                       m_lastTime, m_residentTicks, m_internalTicks, m_externalTicks};
+    for(size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++)
+    {
+        out.put(counters[i]);
+    }
+    doSave(out);
+}
+
+bool MemoryAllocator::load(SnapshotReader& in, const uint32_t& procCount)
+{
+    m_size.resize(in.getCount());
+    for(size_t p = 0; p < m_size.size(); p++)
+    {
+        m_size[p] = in.get();
+    }
+    long* counters[] = {&m_used, &m_reserved, &m_resident, &m_allocations, &m_failures, &m_evictions, &m_peakResident,
+                        &m_lastTime, &m_residentTicks, &m_internalTicks, &m_externalTicks};
+    for(size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++)
+    {
+        *counters[i] = in.get();
+    }
+    return in.check(m_size.size() <= procCount) && doLoad(in, procCount);
+}
+
+PartitionAllocator::PartitionAllocator(const long& totalMemory, const int& partitions, Arena& arena) :
+    MemoryAllocator(totalMemory), m_partitionSize(totalMemory / partitions), m_partitions(partitions, noProcess),
+    m_free(PoolAllocator<int>(arena))
+{
+    for(int i = 0; i < partitions; i++)
+    {
+        m_free.insert(i);
+    }
+}
+
+long PartitionAllocator::doAllocate(const uint32_t& p, const long&)
+{
+    if(m_free.empty())
+    {
+        return 0;
+    }
+
+    int partition = *m_free.begin();
+    m_free.erase(m_free.begin());
+    m_partitions[partition] = p;
+    if(p >= m_partitionOf.size())
+    {
+        m_partitionOf.resize(p + 1, -1);
+    }
+    m_partitionOf[p] = partition;
+    return m_partitionSize;
+}
+
+long PartitionAllocator::doRelease(const uint32_t& p)
+{
+    if(p >= m_partitionOf.size() || m_partitionOf[p] == -1)
+    {
+        return 0;
+    }
+
+    m_partitions[m_partitionOf[p]] = noProcess;
+    m_free.insert(m_partitionOf[p]);
+    m_partitionOf[p] = -1;
+    return m_partitionSize;
+}
+
+bool PartitionAllocator::fitsBeside(const long&, const vector<uint32_t>& kept) const
+{
+    size_t held = 0;
+    for(size_t i = 0; i < kept.size(); i++)
+    {
+        held += kept[i] < m_partitionOf.size() && m_partitionOf[kept[i]] != -1;
+    }
+    return held < m_partitions.size();
+}
+
+void PartitionAllocator::doSave(SnapshotWriter& out) const
+{
+    out.putUnsigned(m_partitions.size());
+    for(size_t i = 0; i < m_partitions.size(); i++)
+    {
+        out.putUnsigned(m_partitions[i] == noProcess ? 0 : m_partitions[i] + 1);
+    }
+}
+
+bool PartitionAllocator::doLoad(SnapshotReader& in, const uint32_t& procCount)
+{
+    if(!in.check(in.getCount() == m_partitions.size()))
+    {
+        return false;
+    }
+    m_partitionOf.assign(procCount, -1);
+    for(size_t i = 0; i < m_partitions.size(); i++)
+    {
+        uint32_t held = in.getIndex(uint64_t(procCount) + 1);
+        if(held != 0)
+        {
+            m_partitions[i] = held - 1;
+            m_free.erase(i);
+            m_partitionOf[held - 1] = i;
+        }
+    }
+    return in.good();
+}
+
+void PartitionAllocator::printState(const ProcessTable& procTable) const
+{
+    cout << "Memory Partitions:" << m_partitions.size() - m_free.size() << " [ ";
+    for(size_t i = 0; i < m_partitions.size(); i++)
+    {
+        if(m_partitions[i] == noProcess)
+        {
+            cout << -1 << ' ';
+        }
+        else
+        {
+            cout << procTable.id[m_partitions[i]] << ' ';
+        }
+    }
+    cout << "]";
+}
+
+BuddyAllocator::BuddyAllocator(const long& totalMemory, const long& minBlock, Arena& arena) :
+    MemoryAllocator(totalMemory), m_minBlock(minBlock), m_maxOrder(0), m_freeLists(1, PoolSet<long>(PoolAllocator<long>(arena)))
+{
+    // memory is one block of the largest order that fits, anything left over is never used
+    while(blockSize(m_maxOrder + 1) <= totalMemory)
+    {
+        m_maxOrder++;
+    }
+    m_totalMemory = blockSize(m_maxOrder);
+    m_freeLists.resize(m_maxOrder + 1, m_freeLists[0]);
+    m_freeLists[m_maxOrder].insert(0);
+}
+
+int BuddyAllocator::orderFor(const long& size) const
+{
+    int order = 0;
+    while(blockSize(order) < size)
+    {
+        order++;
+    }
+    return order;
+}
+
+long BuddyAllocator::doAllocate(const uint32_t& p, const long& size)
+{
+    int order = orderFor(size);
+    int from = order;
+    while(from <= m_maxOrder && m_freeLists[from].empty())
+    {
+        from++;
+    }
+    if(from > m_maxOrder)
+    {
+        return 0;
+    }
+
+    long offset = *m_freeLists[from].begin();
+    m_freeLists[from].erase(m_freeLists[from].begin());
+    while(from > order) // split, keeping the lower half and freeing the upper one
+    {
+        from--;
+        m_freeLists[from].insert(offset + blockSize(from));
+    }
+
+    if(p >= m_blockOf.size())
+    {
+        m_blockOf.resize(p + 1, make_pair(0L, -1));
+    }
+    m_blockOf[p] = make_pair(offset, order);
+    return blockSize(order);
+}
+
+long BuddyAllocator::doRelease(const uint32_t& p)
+{
+    if(p >= m_blockOf.size() || m_blockOf[p].second == -1)
+    {
+        return 0;
+    }
+
+    long offset = m_blockOf[p].first;
+    int order = m_blockOf[p].second;
+    long size = blockSize(order);
+    m_blockOf[p].second = -1;
+
+    while(order < m_maxOrder) // merge with the buddy for as long as it is free
+    {
+        PoolSet<long>::iterator buddy = m_freeLists[order].find(offset ^ blockSize(order));
+        if(buddy == m_freeLists[order].end())
+        {
+            break;
+        }
+        m_freeLists[order].erase(buddy);
+        offset &= ~blockSize(order);
+        order++;
+    }
+    m_freeLists[order].insert(offset);
+    return size;
+}
+
+bool BuddyAllocator::fitsBeside(const long& size, const vector<uint32_t>& kept) const
+{
+    // blocks are aligned to their size, so a block of the order wanted fits wherever an aligned one does in a gap
+    // between the kept blocks
+    vector<pair<long, long> > held;
+    for(size_t i = 0; i < kept.size(); i++)
+    {
+        if(kept[i] < m_blockOf.size() && m_blockOf[kept[i]].second != -1)
+        {
+            held.push_back(make_pair(m_blockOf[kept[i]].first, m_blockOf[kept[i]].first + blockSize(m_blockOf[kept[i]].second)));
+        }
+    }
+    sort(held.begin(), held.end());
+    long want = blockSize(orderFor(size));
+    long gapStart = 0;
+    for(size_t i = 0; i <= held.size(); i++)
+    {
+        long gapEnd = i < held.size() ? held[i].first : m_totalMemory;
+        long aligned = (gapStart + want - 1) / want * want;
+        if(aligned + want <= gapEnd)
+        {
+            return true;
+        }
+        if(i < held.size())
+        {
+            gapStart = held[i].second;
+        }
+    }
+    return false;
+}
+
+long BuddyAllocator::largestFree() const
+{
+    for(int order = m_maxOrder; order >= 0; order--)
+    {
+        if(!m_freeLists[order].empty())
+        {
+            return blockSize(order);
+        }
+    }
+    return 0;
+}
+
+void BuddyAllocator::doSave(SnapshotWriter& out) const
+{
+    for(int order = 0; order <= m_maxOrder; order++)
+    {
+        out.putUnsigned(m_freeLists[order].size());
+        for(PoolSet<long>::const_iterator it = m_freeLists[order].begin(); it != m_freeLists[order].end(); ++it)
+        {
+            out.put(*it);
+        }
+    }
+    out.putUnsigned(m_blockOf.size());
+    for(size_t p = 0; p < m_blockOf.size(); p++)
+    {
+        out.put(m_blockOf[p].first);
+        out.put(m_blockOf[p].second);
+    }
+}
+
+bool BuddyAllocator::doLoad(SnapshotReader& in, const uint32_t& procCount)
+{
+    for(int order = 0; order <= m_maxOrder; order++)
+    {
+        m_freeLists[order].clear();
+        for(uint64_t n = in.getCount(); n > 0; n--)
+        {
+            m_freeLists[order].insert(in.get());
+        }
+    }
+    m_blockOf.resize(in.getCount());
+    for(size_t p = 0; p < m_blockOf.size(); p++)
+    {
+        m_blockOf[p].first = in.get();
+        m_blockOf[p].second = in.get();
+        in.check(m_blockOf[p].second >= -1 && m_blockOf[p].second <= m_maxOrder);
+    }
+    return in.check(m_blockOf.size() <= procCount);
+}
+
+void BuddyAllocator::printState(const ProcessTable&) const
+{
+    cout << "Memory Blocks:" << resident() << " [ free:" << m_totalMemory - reserved() << " largest:" << largestFree() << " ]";
+}
+
+SegregatedFitAllocator::SegregatedFitAllocator(const long& totalMemory, const long& minBlock, const bool& bestFit, Arena& arena) :
+    MemoryAllocator(totalMemory / minBlock * minBlock), m_minBlock(minBlock), m_bestFit(bestFit),
+    m_free(PoolAllocator<pair<const long, long> >(arena)), m_classes(64, PoolSet<pair<long, long> >(PoolAllocator<pair<long, long> >(arena))),
+    m_nonEmpty(0), m_freeSizes(PoolAllocator<long>(arena))
+{
+    addFree(0, m_totalMemory);
+}
+
+void SegregatedFitAllocator::addFree(long offset, long size)
+{
+    m_free[offset] = size;
+    m_freeSizes.insert(size);
+    if(!m_bestFit)
+    {
+        m_byAddress.insert(offset, size);
+        return;
+    }
+    int sizeClass = classOf(size);
+    m_classes[sizeClass].insert(make_pair(size, offset));
+    m_nonEmpty |= 1ULL << sizeClass;
+}
+
+void SegregatedFitAllocator::removeFree(long offset, long size)
+{
+    m_free.erase(offset);
+    m_freeSizes.erase(m_freeSizes.find(size));
+    if(!m_bestFit)
+    {
+        m_byAddress.erase(offset);
+        return;
+    }
+    int sizeClass = classOf(size);
+    m_classes[sizeClass].erase(make_pair(size, offset));
+    if(m_classes[sizeClass].empty())
+    {
+        m_nonEmpty &= ~(1ULL << sizeClass);
+    }
+}
+
+long SegregatedFitAllocator::doAllocate(const uint32_t& p, const long& size)
+{
+    long need = roundUp(size);
+    long offset = -1, found = 0;
+    if(!m_bestFit)
+    {
+        m_byAddress.firstFit(need, offset, found);
+    }
+    else
+    {
+        // blocks in the request's own class may be too small, the smallest that isn't is the best
+        int sizeClass = classOf(need);
+        const PoolSet<pair<long, long> >& own = m_classes[sizeClass];
+        set<pair<long, long> >::const_iterator it = own.lower_bound(make_pair(need, 0L));
+        if(it != own.end())
+        {
+            found = it->first;
+            offset = it->second;
+        }
+
+        // every block in a larger class fits, the smallest of the first non-empty one is the best
+        unsigned long long larger = sizeClass < 63 ? m_nonEmpty & (~0ULL << (sizeClass + 1)) : 0;
+        if(offset == -1 && larger != 0)
+        {
+            const pair<long, long>& first = *m_classes[__builtin_ctzll(larger)].begin();
+            found = first.first;
+            offset = first.second;
+        }
+    }
+
+    if(offset == -1)
+    {
+        return 0;
+    }
+
+    removeFree(offset, found);
+    if(found > need)
+    {
+        addFree(offset + need, found - need);
+    }
+
+    if(p >= m_blockOf.size())
+    {
+        m_blockOf.resize(p + 1, make_pair(0L, 0L));
+    }
+    m_blockOf[p] = make_pair(offset, need);
+    return need;
+}
+
+long SegregatedFitAllocator::doRelease(const uint32_t& p)
+{
+    if(p >= m_blockOf.size() || m_blockOf[p].second == 0)
+    {
+        return 0;
+    }
+
+    long offset = m_blockOf[p].first;
+    long size = m_blockOf[p].second;
+    long freed = size;
+    m_blockOf[p].second = 0;
+
+    PoolMap<long, long>::iterator next = m_free.lower_bound(offset);
+    if(next != m_free.end() && offset + size == next->first) // merge with the free block after it
+    {
+        size += next->second;
+        removeFree(next->first, next->second);
+        next = m_free.lower_bound(offset);
+    }
+    if(next != m_free.begin())
+    {
+        map<long, long>::iterator prev = next;
+        --prev;
+        if(prev->first + prev->second == offset) // and the one before it
+        {
+            offset = prev->first;
+            size += prev->second;
+            removeFree(prev->first, prev->second);
+        }
+    }
+    addFree(offset, size);
+    return freed;
+}
+
+bool SegregatedFitAllocator::fitsBeside(const long& size, const vector<uint32_t>& kept) const
+{
+    // free blocks are merged, so with only the kept blocks left every gap between them is a single free block
+    vector<pair<long, long> > held;
+    for(size_t i = 0; i < kept.size(); i++)
+    {
+        if(kept[i] < m_blockOf.size() && m_blockOf[kept[i]].second != 0)
+        {
+            held.push_back(m_blockOf[kept[i]]);
+        }
+    }
+    sort(held.begin(), held.end());
+    long need = roundUp(size);
+    long gapStart = 0;
+    for(size_t i = 0; i < held.size(); i++)
+    {
+        if(held[i].first - gapStart >= need)
+        {
+            return true;
+        }
+        gapStart = held[i].first + held[i].second;
+    }
+    return m_totalMemory - gapStart >= need;
+}
+
+void SegregatedFitAllocator::doSave(SnapshotWriter& out) const
+{
+    out.putUnsigned(m_free.size());
+    for(PoolMap<long, long>::const_iterator it = m_free.begin(); it != m_free.end(); ++it)
+    {
+        out.put(it->first);
+        out.put(it->second);
+    }
+    out.putUnsigned(m_blockOf.size());
+    for(size_t p = 0; p < m_blockOf.size(); p++)
+    {
+        out.put(m_blockOf[p].first);
+        out.put(m_blockOf[p].second);
+    }
+}
+
+bool SegregatedFitAllocator::doLoad(SnapshotReader& in, const uint32_t& procCount)
+{
+    while(!m_free.empty())
+    {
+        removeFree(m_free.begin()->first, m_free.begin()->second);
+    }
+    for(uint64_t n = in.getCount(); n > 0; n--)
+    {
+        long offset = in.get();
+        long size = in.get();
+        if(in.check(size > 0))
+        {
+            addFree(offset, size);
+        }
+    }
+    m_blockOf.resize(in.getCount());
+    for(size_t p = 0; p < m_blockOf.size(); p++)
+    {
+        m_blockOf[p].first = in.get();
+        m_blockOf[p].second = in.get();
+    }
+    return in.check(m_blockOf.size() <= procCount);
+}
+
+void SegregatedFitAllocator::printState(const ProcessTable&) const
+{
+    cout << "Memory Blocks:" << resident() << " [ free:" << m_totalMemory - reserved() << " largest:" << largestFree() << " ]";
+}
+
+// The page reference model: a process works on a window of workingSet pages that moves somewhere else every
+// phaseLength time steps of running, with the odd reference anywhere in its address space
+static const long phaseLength = 64;
+static const uint64_t localityPercent = 90;     // References that fall in the working set
+static const uint64_t writePercent = 25;        // References that write and so dirty the page
+
+// A level is thrashing in a window of thrashWindow time steps when at least thrashFaultPercent of the
+// references it made faulted, out of at least thrashReferences so a few faults don't count
+static const long thrashWindow = 100;
+static const long thrashReferences = 10;
+static const long thrashFaultPercent = 25;
+
+// Most pages a single process can have, more than that is a workload mistake rather than a big process
+static const long maxProcessPages = 1L << 20;
+
+const uint32_t PagedMemory::noPage;
+const uint32_t PagedMemory::noFrame;
+
+PagedMemory::PagedMemory(const MemConfig& config) :
+    MemoryAllocator(config.totalMemory / config.pageSize * config.pageSize), m_pageSize(config.pageSize),
+    m_replacement(config.replacement), m_workingSet(config.workingSet), m_swapTime(config.swapTime),
+    m_swapDevice(config.swapDevice), m_hand(0), m_ghostStamp(0), m_windowEnd(thrashWindow)
+{
+    uint32_t frames = config.totalMemory / config.pageSize;
+    m_firstInLimit = max<uint32_t>(frames / 4, 1);
+    m_ghostLimit = max<uint32_t>(frames / 2, 1);
+    m_page.assign(frames, noPage);
+    m_dirty.assign(frames, 0);
+    m_referenced.assign(frames, 0);
+    m_list.assign(frames, noList);
+    m_next.assign(frames, noFrame);
+    m_prev.assign(frames, noFrame);
+    for(int list = 0; list < 2; list++)
+    {
+        m_head[list] = m_tail[list] = noFrame;
+        m_length[list] = 0;
+    }
+    for(uint32_t frame = frames; frame > 0; frame--) // frame 0 is used first
+    {
+        m_free.push_back(frame - 1);
+    }
+}
+
+bool PagedMemory::canHold(const long& size) const
+{
+    return (size + m_pageSize - 1) / m_pageSize <= maxProcessPages;
+}
+
+long PagedMemory::doAllocate(const uint32_t& p, const long& size)
+{
+    if(p >= m_firstPage.size())
+    {
+        m_firstPage.resize(p + 1, noPage);
+        m_pageCount.resize(p + 1, 0);
+        m_spanStart.resize(p + 1, 0);
+        m_spanPages.resize(p + 1, 0);
+        m_holds.resize(p + 1, 0);
+        m_faulted.resize(p + 1, 0);
+    }
+    if(m_firstPage[p] == noPage) // first admission, number its pages
+    {
+        uint32_t pages = max<long>((size + m_pageSize - 1) / m_pageSize, 1);
+        if(pages > m_spanPages[p]) // doubled, so a slot only moves a few times
+        {
+            m_spanPages[p] = max(pages, 2 * m_spanPages[p]);
+            m_spanStart[p] = m_frameOf.size();
+            m_frameOf.resize(m_frameOf.size() + m_spanPages[p], noFrame);
+            m_ghost.resize(m_frameOf.size(), 0);
+        }
+        m_firstPage[p] = m_spanStart[p];
+        m_pageCount[p] = pages;
+    }
+    m_holds[p] = 1;
+    return long(m_pageCount[p]) * m_pageSize;
+}
+
+long PagedMemory::doRelease(const uint32_t& p)
+{
+    if(p >= m_holds.size() || !m_holds[p])
+    {
+        return 0;
+    }
+    m_holds[p] = 0;
+    return long(m_pageCount[p]) * m_pageSize;
+}
+
+uint32_t PagedMemory::pageOf(const uint32_t& p, const unsigned int& id, const long& tick, bool& write) const
+{
+    uint64_t pages = m_pageCount[p];
+    uint64_t stream = mix(id);
+    uint64_t hash = mix(stream ^ uint64_t(tick));
+    write = hash % 100 < writePercent;
+    hash >>= 8;
+    if(hash % 100 >= localityPercent)
+    {
+        return (hash >> 8) % pages;
+    }
+    uint64_t windowStart = mix(stream + uint64_t(tick / phaseLength) * 0x9E3779B97F4A7C15ULL) % pages;
+    return (windowStart + (hash >> 8) % min<uint64_t>(m_workingSet, pages)) % pages;
+}
+
+long PagedMemory::reference(const uint32_t& p, const unsigned int& id, const long& tick, const int& level, const long& time)
+{
+    if(time > m_windowEnd)
+    {
+        closeWindows(time);
+    }
+    if(m_faulted[p])
+    {
+        m_faulted[p] = 0;
+        return 0;
+    }
+    size_t l = max(level, 0);
+    if(l >= m_levels.size())
+    {
+        m_levels.resize(l + 1);
+    }
+    LevelStats& stats = m_levels[l];
+    stats.references++;
+    stats.windowReferences++;
+
+    bool write;
+    uint32_t page = m_firstPage[p] + pageOf(p, id, tick, write);
+    uint32_t frame = m_frameOf[page];
+    if(frame != noFrame) // hit
+    {
+        touched(frame);
+        m_dirty[frame] |= write;
+        return 0;
+    }
+
+    // fault, the page goes in a free frame or in place of the one the policy gives up, which is swapped out
+    // first if it was written to. The swap out counts against the level of the process that faulted
+    stats.faults++;
+    stats.windowFaults++;
+    stats.swapIns++;
+    long wait = m_swapTime;
+    if(m_free.empty())
+    {
+        frame = victim();
+        if(m_dirty[frame])
+        {
+            stats.swapOuts++;
+            wait += m_swapTime;
+        }
+        m_frameOf[m_page[frame]] = noFrame;
+    }
+    else
+    {
+        frame = m_free.back();
+        m_free.pop_back();
+    }
+    m_page[frame] = page;
+    m_frameOf[page] = frame;
+    m_dirty[frame] = write;
+    loaded(frame);
+    m_faulted[p] = 1;
+    return wait;
+}
+
+void PagedMemory::processDone(const uint32_t& p)
+{
+    if(p >= m_firstPage.size() || m_firstPage[p] == noPage)
+    {
+        return;
+    }
+    for(uint32_t page = m_firstPage[p]; page < m_firstPage[p] + m_pageCount[p]; page++)
+    {
+        m_ghost[page] = 0; // its A1out entry goes stale
+        uint32_t frame = m_frameOf[page];
+        if(frame != noFrame)
+        {
+            m_frameOf[page] = noFrame;
+            forget(frame);
+            m_free.push_back(frame);
+        }
+    }
+    m_firstPage[p] = noPage; // the next process in the slot numbers its pages again
+}
+
+void PagedMemory::touched(const uint32_t& frame)
+{
+    switch(m_replacement)
+    {
+        case lruReplacement:
+            unlink(frame);
+            pushFront(recentList, frame);
+            break;
+        case clockReplacement:
+            m_referenced[frame] = 1;
+            break;
+        case twoQReplacement:
+            if(m_list[frame] == recentList) // a hit on A1in doesn't promote, the page has to come back after it was evicted
+            {
+                unlink(frame);
+                pushFront(recentList, frame);
+            }
+            break;
+    }
+}
+
+void PagedMemory::loaded(const uint32_t& frame)
+{
+    switch(m_replacement)
+    {
+        case lruReplacement:
+            pushFront(recentList, frame);
+            break;
+        case clockReplacement:
+            m_referenced[frame] = 1;
+            break;
+        case twoQReplacement:
+            if(m_ghost[m_page[frame]] != 0) // evicted from A1in not long ago, so it is worth keeping
+            {
+                m_ghost[m_page[frame]] = 0;
+                pushFront(recentList, frame);
+            }
+            else
+            {
+                pushFront(firstList, frame);
+            }
+            break;
+    }
+}
+
+uint32_t PagedMemory::victim()
+{
+    uint32_t frame = noFrame;
+    switch(m_replacement)
+    {
+        case lruReplacement:
+            frame = m_tail[recentList];
+            unlink(frame);
+            break;
+        case clockReplacement: // every frame is in use, so the hand stops within a turn
+            while(m_referenced[m_hand])
+            {
+                m_referenced[m_hand] = 0;
+                m_hand = m_hand + 1 == m_page.size() ? 0 : m_hand + 1;
+            }
+            frame = m_hand;
+            m_hand = m_hand + 1 == m_page.size() ? 0 : m_hand + 1;
+            break;
+        case twoQReplacement:
+            if(m_length[firstList] > m_firstInLimit || m_length[recentList] == 0)
+            {
+                frame = m_tail[firstList];
+                uint32_t page = m_page[frame];
+                if(++m_ghostStamp == 0)
+                {
+                    m_ghostStamp = 1;
+                }
+                m_ghost[page] = m_ghostStamp;
+                m_ghosts.push_back(make_pair(page, m_ghostStamp));
+                if(m_ghosts.size() > m_ghostLimit)
+                {
+                    if(m_ghost[m_ghosts.front().first] == m_ghosts.front().second)
+                    {
+                        m_ghost[m_ghosts.front().first] = 0;
+                    }
+                    m_ghosts.pop_front();
+                }
+            }
+            else
+            {
+                frame = m_tail[recentList];
+            }
+            unlink(frame);
+            break;
+    }
+    return frame;
+}
+
+void PagedMemory::forget(const uint32_t& frame)
+{
+    if(m_list[frame] != noList)
+    {
+        unlink(frame);
+    }
+    m_page[frame] = noPage;
+    m_dirty[frame] = 0;
+    m_referenced[frame] = 0;
+}
+
+void PagedMemory::pushFront(const int& list, const uint32_t& frame)
+{
+    m_prev[frame] = noFrame;
+    m_next[frame] = m_head[list];
+    if(m_head[list] == noFrame)
+    {
+        m_tail[list] = frame;
+    }
+    else
+    {
+        m_prev[m_head[list]] = frame;
+    }
+    m_head[list] = frame;
+    m_list[frame] = list;
+    m_length[list]++;
+}
+
+void PagedMemory::unlink(const uint32_t& frame)
+{
+    int list = m_list[frame];
+    if(m_prev[frame] == noFrame)
+    {
+        m_head[list] = m_next[frame];
+    }
+    else
+    {
+        m_next[m_prev[frame]] = m_next[frame];
+    }
+    if(m_next[frame] == noFrame)
+    {
+        m_tail[list] = m_prev[frame];
+    }
+    else
+    {
+        m_prev[m_next[frame]] = m_prev[frame];
+    }
+    m_next[frame] = m_prev[frame] = noFrame;
+    m_list[frame] = noList;
+    m_length[list]--;
+}
+
+bool PagedMemory::active(const LevelStats& stats) const
+{
+    return stats.windowReferences >= thrashReferences;
+}
+
+bool PagedMemory::thrashing(const LevelStats& stats) const
+{
+    return active(stats) && stats.windowFaults * 100 >= stats.windowReferences * thrashFaultPercent;
+}
+
+void PagedMemory::closeWindows(const long& time)
+{
+    for(size_t l = 0; l < m_levels.size(); l++)
+    {
+        LevelStats& stats = m_levels[l];
+        stats.activeWindows += active(stats);
+        if(thrashing(stats))
+        {
+            stats.thrashingWindows++;
+            if(stats.firstThrashing == -1)
+            {
+                stats.firstThrashing = m_windowEnd - thrashWindow + 1;
+            }
+        }
+        stats.windowReferences = stats.windowFaults = 0;
+    }
+    m_windowEnd = (time - 1) / thrashWindow * thrashWindow + thrashWindow;
+}
+
+void PagedMemory::printState(const ProcessTable&) const
+{
+    long faults = 0;
+    for(size_t l = 0; l < m_levels.size(); l++)
+    {
+        faults += m_levels[l].faults;
+    }
+    cout << "Memory Frames:" << m_page.size() - m_free.size() << " [ free:" << m_free.size() << " faults:" << faults << " ]";
+}
+
+void PagedMemory::printReport(const string& name) const
+{
+    MemoryAllocator::printReport(name);
+
+    LevelStats total;
+    for(size_t l = 0; l < m_levels.size(); l++)
+    {
+        total.references += m_levels[l].references;
+        total.faults += m_levels[l].faults;
+        total.swapIns += m_levels[l].swapIns;
+        total.swapOuts += m_levels[l].swapOuts;
+    }
+    cout << "Paging:" << endl;
+    cout << m_page.size() << " frames of " << m_pageSize << " bytes, " << replacementName(m_replacement) << " replacement, working set "
+         << m_workingSet << " pages, swapping a page takes " << m_swapTime << " time steps on device " << m_swapDevice << endl;
+    cout << "references " << total.references << ", page faults " << total.faults << " (" << fixed << setprecision(2)
+         << (total.references > 0 ? 100.0 * total.faults / total.references : 0.0) << "%), swapped in " << total.swapIns
+         << " pages, swapped out " << total.swapOuts << ", " << (total.swapIns + total.swapOuts) * m_pageSize << " bytes of swap traffic" << endl;
+    for(size_t l = 0; l < m_levels.size(); l++)
+    {
+        LevelStats stats = m_levels[l];
+        if(stats.references == 0)
+        {
+            continue;
+        }
+        stats.activeWindows += active(stats); // the window the run ended in
+        if(thrashing(stats))
+        {
+            stats.thrashingWindows++;
+            if(stats.firstThrashing == -1)
+            {
+                stats.firstThrashing = m_windowEnd - thrashWindow + 1;
+            }
+        }
+        cout << "level " << l << ": references " << stats.references << ", page faults " << stats.faults << " ("
+             << (100.0 * stats.faults / stats.references) << "%), swapped in " << stats.swapIns << " pages, swapped out "
+             << stats.swapOuts << ", thrashing in " << stats.thrashingWindows << " of " << stats.activeWindows << " windows of "
+             << thrashWindow << " time steps";
+        if(stats.firstThrashing != -1)
+        {
+            cout << ", first at time step " << stats.firstThrashing;
+        }
+        cout << endl;
+    }
+}
+
+void PagedMemory::doSave(SnapshotWriter& out) const
+{
+    out.putUnsigned(m_firstPage.size());
+    for(size_t p = 0; p < m_firstPage.size(); p++)
+    {
+        out.putUnsigned(m_firstPage[p] == noPage ? 0 : uint64_t(m_firstPage[p]) + 1);
+        out.putUnsigned(m_pageCount[p]);
+        out.putUnsigned(m_spanStart[p]);
+        out.putUnsigned(m_spanPages[p]);
+        out.putUnsigned(m_holds[p]);
+        out.putUnsigned(m_faulted[p]);
+    }
+    out.putUnsigned(m_frameOf.size());
+    for(size_t frame = 0; frame < m_page.size(); frame++)
+    {
+        out.putUnsigned(m_page[frame] == noPage ? 0 : uint64_t(m_page[frame]) + 1);
+        out.putUnsigned(m_dirty[frame]);
+        out.putUnsigned(m_referenced[frame]);
+    }
+    for(int list = 0; list < 2; list++) // front to back
+    {
+        out.putUnsigned(m_length[list]);
+        for(uint32_t frame = m_head[list]; frame != noFrame; frame = m_next[frame])
+        {
+            out.putUnsigned(frame);
+        }
+    }
+    out.putUnsigned(m_free.size());
+    for(size_t i = 0; i < m_free.size(); i++)
+    {
+        out.putUnsigned(m_free[i]);
+    }
+    out.putUnsigned(m_hand);
+    out.putUnsigned(m_ghostStamp);
+    out.putUnsigned(m_ghosts.size());
+    for(size_t i = 0; i < m_ghosts.size(); i++)
+    {
+        out.putUnsigned(m_ghosts[i].first);
+        out.putUnsigned(m_ghosts[i].second);
+        out.putUnsigned(m_ghost[m_ghosts[i].first] == m_ghosts[i].second); // not stale
+    }
+    out.putUnsigned(m_levels.size());
+    for(size_t l = 0; l < m_levels.size(); l++)
+    {
+        const LevelStats& stats = m_levels[l];
+        long counters[] = {stats.references, stats.faults, stats.swapIns, stats.swapOuts, stats.windowReferences,
+                           stats.windowFaults, stats.activeWindows, stats.thrashingWindows, stats.firstThrashing};
+        for(size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++)
+        {
+            out.put(counters[i]);
+        }
+    }
+    out.put(m_windowEnd);
+}
+
+bool PagedMemory::doLoad(SnapshotReader& in, const uint32_t& procCount)
+{
+    size_t processes = in.getCount();
+    if(!in.check(processes <= procCount))
+    {
+        return false;
+    }
+    m_firstPage.resize(processes);
+    m_pageCount.resize(processes);
+    m_spanStart.resize(processes);
+    m_spanPages.resize(processes);
+    m_holds.resize(processes);
+    m_faulted.resize(processes);
+    vector<pair<uint32_t, uint32_t> > spans; // to check the pages, in the order they were numbered
+    for(size_t p = 0; p < processes; p++)
+    {
+        m_firstPage[p] = uint32_t(in.getUnsigned()) - 1;
+        m_pageCount[p] = in.getUnsigned();
+        m_spanStart[p] = in.getUnsigned();
+        m_spanPages[p] = in.getUnsigned();
+        m_holds[p] = in.getIndex(2);
+        m_faulted[p] = in.getIndex(2);
+        if(m_spanPages[p] != 0)
+        {
+            spans.push_back(make_pair(m_spanStart[p], m_spanPages[p]));
+        }
+        in.check(m_firstPage[p] == noPage || (m_firstPage[p] == m_spanStart[p] && m_pageCount[p] > 0 && m_pageCount[p] <= m_spanPages[p]));
+    }
+    uint64_t pages = in.getUnsigned();
+    if(!in.check(pages < noPage))
+    {
+        return false;
+    }
+    for(size_t i = 0; i < spans.size(); i++)
+    {
+        in.check(spans[i].second > 0 && uint64_t(spans[i].first) + spans[i].second <= pages);
+    }
+    m_frameOf.assign(pages, noFrame);
+    m_ghost.assign(pages, 0);
+
+    for(size_t frame = 0; frame < m_page.size(); frame++)
+    {
+        m_page[frame] = in.getIndex(pages + 1) - 1;
+        m_dirty[frame] = in.getIndex(2);
+        m_referenced[frame] = in.getIndex(2);
+        m_list[frame] = noList;
+        m_next[frame] = m_prev[frame] = noFrame;
+        if(m_page[frame] != noPage && in.check(m_frameOf[m_page[frame]] == noFrame))
+        {
+            m_frameOf[m_page[frame]] = frame;
+        }
+    }
+    for(int list = 0; list < 2; list++)
+    {
+        m_head[list] = m_tail[list] = noFrame;
+        m_length[list] = 0;
+        vector<uint32_t> frames(in.getCount());
+        for(size_t i = 0; i < frames.size(); i++)
+        {
+            frames[i] = in.getIndex(m_page.size());
+        }
+        for(size_t i = frames.size(); i > 0 && in.good(); i--) // back to front
+        {
+            uint32_t frame = frames[i - 1];
+            if(in.check(m_list[frame] == noList && m_page[frame] != noPage))
+            {
+                pushFront(list, frame);
+            }
+        }
+    }
+    m_free.resize(in.getCount());
+    for(size_t i = 0; i < m_free.size(); i++)
+    {
+        m_free[i] = in.getIndex(m_page.size());
+        in.check(m_page[m_free[i]] == noPage);
+    }
+    in.check(m_free.size() <= m_page.size());
+    m_hand = in.getIndex(m_page.size());
+    m_ghostStamp = in.getUnsigned();
+    m_ghosts.resize(in.getCount());
+    for(size_t i = 0; i < m_ghosts.size(); i++)
+    {
+        m_ghosts[i].first = in.getIndex(pages);
+        m_ghosts[i].second = in.getUnsigned();
+        if(in.getIndex(2) && in.good())
+        {
+            m_ghost[m_ghosts[i].first] = m_ghosts[i].second;
+        }
+    }
+    m_levels.resize(in.getCount());
+    for(size_t l = 0; l < m_levels.size(); l++)
+    {
+        LevelStats& stats = m_levels[l];
+        long* counters[] = {&stats.references, &stats.faults, &stats.swapIns, &stats.swapOuts, &stats.windowReferences,
+                            &stats.windowFaults, &stats.activeWindows, &stats.thrashingWindows, &stats.firstThrashing};
+        for(size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++)
+        {
+            *counters[i] = in.get();
+        }
+    }
+    m_windowEnd = in.get();
+    return in.good();
+}
+
+const uint32_t AddressTree::none;
+
+void AddressTree::update(const uint32_t& n)
+{
+    Node& node = m_nodes[n];
+    node.largest = max(node.size, max(largest(node.left), largest(node.right)));
+}
+
+uint32_t AddressTree::merge(uint32_t a, uint32_t b)
+{
+    if(a == none || b == none)
+    {
+        return a == none ? b : a;
+    }
+    if(m_nodes[a].priority > m_nodes[b].priority) // every offset in a is below every offset in b
+    {
+        m_nodes[a].right = merge(m_nodes[a].right, b);
+        update(a);
+        return a;
+    }
+    m_nodes[b].left = merge(a, m_nodes[b].left);
+    update(b);
+    return b;
+}
+
+void AddressTree::split(uint32_t n, const long& offset, uint32_t& less, uint32_t& rest)
+{
+    if(n == none)
+    {
+        less = rest = none;
+        return;
+    }
+    if(m_nodes[n].offset < offset)
+    {
+        split(m_nodes[n].right, offset, m_nodes[n].right, rest);
+        less = n;
+    }
+    else
+    {
+        split(m_nodes[n].left, offset, less, m_nodes[n].left);
+        rest = n;
+    }
+    update(n);
+}
+
+void AddressTree::insert(const long& offset, const long& size)
+{
+    uint32_t n;
+    if(m_unused.empty())
+    {
+        n = m_nodes.size();
+        m_nodes.push_back(Node());
+    }
+    else
+    {
+        n = m_unused.back();
+        m_unused.pop_back();
+    }
+    Node& node = m_nodes[n];
+    node.offset = offset;
+    node.size = node.largest = size;
+    node.priority = mix(offset);
+    node.left = node.right = none;
+
+    uint32_t less, rest;
+    split(m_root, offset, less, rest);
+    m_root = merge(merge(less, n), rest);
+}
+
+void AddressTree::erase(const long& offset)
+{
+    uint32_t less, rest, at, after;
+    split(m_root, offset, less, rest);
+    split(rest, offset + 1, at, after);
+    if(at != none)
+    {
+        m_unused.push_back(at);
+    }
+    m_root = merge(less, after);
+}
+
+bool AddressTree::firstFit(const long& size, long& offset, long& found) const
+{
+    uint32_t n = m_root;
+    if(largest(n) < size)
+    {
+        return false;
+    }
+    while(true) // the subtree at n has a block that fits
+    {
+        const Node& node = m_nodes[n];
+        if(largest(node.left) >= size)
+        {
+            n = node.left;
+        }
+        else if(node.size >= size)
+        {
+            offset = node.offset;
+            found = node.size;
+            return true;
+        }
+        else
+        {
+            n = node.right;
+        }
+    }
+}
+
+unique_ptr<MemoryAllocator> makeAllocator(const MemConfig& config, Arena& arena)
+{
+    switch(config.allocator)
+    {
+        case buddyAllocator:
+            return unique_ptr<MemoryAllocator>(new BuddyAllocator(config.totalMemory, config.minBlock, arena));
+        case firstFitAllocator:
+            return unique_ptr<MemoryAllocator>(new SegregatedFitAllocator(config.totalMemory, config.minBlock, false, arena));
+        case bestFitAllocator:
+            return unique_ptr<MemoryAllocator>(new SegregatedFitAllocator(config.totalMemory, config.minBlock, true, arena));
+        case pagedAllocator:
+            return unique_ptr<MemoryAllocator>(new PagedMemory(config));
+        case partitionAllocator:
+        default:
+            return unique_ptr<MemoryAllocator>(new PartitionAllocator(config.totalMemory, config.partitions, arena));
+    }
+}
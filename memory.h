@@ -0,0 +1,367 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include<vector>
+#include<map>
+#include<set>
+#include<deque>
+#include<string>
+#include<memory>     //for unique_ptr
+#include<iostream>
+using namespace std;
+
+#include "process.h"
+#include "arena.h"
+#include "snapshot.h"
+
+enum Allocator { partitionAllocator, buddyAllocator, firstFitAllocator, bestFitAllocator, pagedAllocator };
+
+enum Replacement { lruReplacement, clockReplacement, twoQReplacement }; // Which frame the paged model gives up on a fault
+
+struct MemConfig
+{
+    MemConfig() : allocator(partitionAllocator), totalMemory(1024), partitions(4), minBlock(16), pageSize(16),
+                  replacement(lruReplacement), workingSet(4), swapTime(10), swapDevice(0) {}
+
+    Allocator allocator;
+    long totalMemory;   // Bytes of memory in the machine
+    int partitions;     // Number of equal fixed partitions for the partition allocator
+    long minBlock;      // Smallest block the buddy and free list allocators hand out, requests are rounded up to it
+
+    // The paged model, see PagedMemory
+    long pageSize;              // Bytes in a page and in a frame of memory
+    Replacement replacement;
+    long workingSet;            // Pages a process keeps going back to at any one time
+    long swapTime;              // Time steps to move a page between memory and the swap device
+    unsigned int swapDevice;    // The IO device pages are swapped to, see --device
+};
+
+// Parses the name of an allocator as given on the command line, returns false if it isn't one
+bool parseAllocator(const string& name, Allocator& allocator);
+
+// The command line name of an allocator
+string allocatorName(const Allocator& allocator);
+
+// Same for the page replacement policies
+bool parseReplacement(const string& name, Replacement& replacement);
+string replacementName(const Replacement& replacement);
+
+// Interface of every memory model. Processes are identified by their process table index and hold at most
+// one allocation each. Besides the allocation itself this keeps the counters the end of run report uses
+class MemoryAllocator
+{
+    public:
+      MemoryAllocator(const long& totalMemory);
+      virtual ~MemoryAllocator() {}
+
+      // Give process p size bytes, returns false if there isn't room for it right now
+      bool allocate(const uint32_t& p, const long& size);
+
+      // Give back the memory held by p, returns false if it didn't hold any
+      bool release(const uint32_t& p);
+
+      // Take the memory away from p so another process can have it
+      bool evict(const uint32_t& p);
+
+      // Whether a request for size bytes could ever be satisfied, even with nothing else resident
+      virtual bool canHold(const long& size) const = 0;
+
+      // Whether a request for size bytes could be satisfied if only the processes in kept held memory, where
+      // they hold it now, i.e. whether evicting everybody else would make room
+      virtual bool fitsBeside(const long& size, const vector<uint32_t>& kept) const = 0;
+
+      long used() const {return m_used;}                // Bytes requested by resident processes
+      long reserved() const {return m_reserved;}        // Bytes handed out to resident processes, rounding included
+      long resident() const {return m_resident;}        // Number of processes holding memory
+      long internalFragmentation() const {return m_reserved - m_used;}
+      virtual long largestFree() const = 0;
+      long externalFragmentation() const {return m_totalMemory - m_reserved - largestFree();} // Free bytes outside the largest free block
+
+      // Prints the part of the per time step line that describes memory, up to the "usedMem:" field
+      virtual void printState(const ProcessTable& procTable) const = 0;
+
+      // Called at the start of every simulated time step and once after the last one, time weights the averages
+      // in the report by how long each state lasted
+      void account(const long& time);
+
+      // End of run summary
+      virtual void printReport(const string& name) const;
+
+      // Writes the allocations and the counters to a snapshot
+      void save(SnapshotWriter& out) const;
+
+      // Reads back what save wrote into an allocator made with the same configuration that hasn't been used yet,
+      // procCount is the size of the restored process table. Returns false if the snapshot doesn't fit
+      bool load(SnapshotReader& in, const uint32_t& procCount);
+
+    protected:
+      // Reserve memory for p and return how many bytes it got, 0 if it can't be done
+      virtual long doAllocate(const uint32_t& p, const long& size) = 0;
+
+      // Free the memory held by p and return how many bytes it had reserved, 0 if it had nothing
+      virtual long doRelease(const uint32_t& p) = 0;
+
+      // Write and read back the free space and who holds what, for save and load
+      virtual void doSave(SnapshotWriter& out) const = 0;
+      virtual bool doLoad(SnapshotReader& in, const uint32_t& procCount) = 0;
+
+      long m_totalMemory;
+
+    private:
+      vector<long> m_size;    // Bytes requested by each process while it is resident
+
+      long m_used;
+      long m_reserved;
+      long m_resident;
+
+      long m_allocations;
+      long m_failures;
+      long m_evictions;
+      long m_peakResident;
+
+      long m_lastTime;
+      long m_residentTicks;   // Resident processes, internal and external fragmentation summed over time steps
+      long m_internalTicks;
+      long m_externalTicks;
+};
+
+// The original memory model, a number of equal fixed partitions each holding one process whatever its size
+class PartitionAllocator : public MemoryAllocator
+{
+    public:
+      PartitionAllocator(const long& totalMemory, const int& partitions, Arena& arena);
+
+      bool canHold(const long&) const {return true;}
+      bool fitsBeside(const long& size, const vector<uint32_t>& kept) const;
+      long largestFree() const {return m_free.empty() ? 0 : m_partitionSize;}
+      void printState(const ProcessTable& procTable) const;
+
+    protected:
+      long doAllocate(const uint32_t& p, const long& size);
+      long doRelease(const uint32_t& p);
+      void doSave(SnapshotWriter& out) const;
+      bool doLoad(SnapshotReader& in, const uint32_t& procCount);
+
+    private:
+      long m_partitionSize;
+      vector<uint32_t> m_partitions;   // The process in each partition, noProcess if it is free
+      PoolSet<int> m_free;             // Free partitions, the lowest numbered one is used first
+      vector<int> m_partitionOf;       // The partition of each process, -1 if it has none
+};
+
+// Binary buddy allocator, blocks are powers of two from minBlock up to the whole of memory. Each order has a
+// free list ordered by address, so allocating and freeing are O(log n)
+class BuddyAllocator : public MemoryAllocator
+{
+    public:
+      BuddyAllocator(const long& totalMemory, const long& minBlock, Arena& arena);
+
+      bool canHold(const long& size) const {return orderFor(size) <= m_maxOrder;}
+      bool fitsBeside(const long& size, const vector<uint32_t>& kept) const;
+      long largestFree() const;
+      void printState(const ProcessTable& procTable) const;
+
+    protected:
+      long doAllocate(const uint32_t& p, const long& size);
+      long doRelease(const uint32_t& p);
+      void doSave(SnapshotWriter& out) const;
+      bool doLoad(SnapshotReader& in, const uint32_t& procCount);
+
+    private:
+      int orderFor(const long& size) const;
+      long blockSize(const int& order) const {return m_minBlock << order;}
+
+      long m_minBlock;
+      int m_maxOrder;
+      vector<PoolSet<long> > m_freeLists;      // Offsets of the free blocks of each order
+      vector<pair<long, int> > m_blockOf;      // Offset and order of the block held by each process, order -1 if none
+};
+
+// Free blocks by offset, where every subtree knows the largest block in it, so the lowest addressed block of at
+// least some size is found in O(log n) by going left whenever the left subtree has one. A treap, with the
+// priorities hashed from the offsets and the nodes in a vector, linked by index
+class AddressTree
+{
+    public:
+      AddressTree() : m_root(none) {}
+
+      void insert(const long& offset, const long& size);
+      void erase(const long& offset);
+
+      // Sets offset and found to the lowest addressed block of at least size bytes, returns false if there is none
+      bool firstFit(const long& size, long& offset, long& found) const;
+
+    private:
+      static const uint32_t none = 0xFFFFFFFF;
+
+      struct Node
+      {
+          long offset;
+          long size;
+          long largest;       // Of the blocks in the subtree
+          uint64_t priority;  // Max heap ordered
+          uint32_t left;
+          uint32_t right;
+      };
+
+      long largest(const uint32_t& n) const {return n == none ? 0 : m_nodes[n].largest;}
+      void update(const uint32_t& n);
+      // Node indexes are passed by value, the links they are read from are written on the way back
+      uint32_t merge(uint32_t a, uint32_t b);
+      void split(uint32_t n, const long& offset, uint32_t& less, uint32_t& rest); // less gets the offsets below offset
+
+      vector<Node> m_nodes;
+      vector<uint32_t> m_unused;      // Nodes of erased blocks, used again first
+      uint32_t m_root;
+};
+
+// Variable size blocks rounded up to minBlock. Freed blocks are merged with free neighbours so free blocks never
+// touch. First fit takes the lowest addressed block that fits, from an AddressTree in O(log n). Best fit takes
+// the smallest, with the free blocks segregated into power of two size classes: a bitmap of the non-empty
+// classes finds the first class larger than the request's, which is sure to fit, in O(1), and a class is ordered
+// by size so the request's own class is searched in O(log n)
+class SegregatedFitAllocator : public MemoryAllocator
+{
+    public:
+      SegregatedFitAllocator(const long& totalMemory, const long& minBlock, const bool& bestFit, Arena& arena);
+
+      bool canHold(const long& size) const {return roundUp(size) <= m_totalMemory;}
+      bool fitsBeside(const long& size, const vector<uint32_t>& kept) const;
+      long largestFree() const {return m_freeSizes.empty() ? 0 : *m_freeSizes.rbegin();}
+      void printState(const ProcessTable& procTable) const;
+
+    protected:
+      long doAllocate(const uint32_t& p, const long& size);
+      long doRelease(const uint32_t& p);
+      void doSave(SnapshotWriter& out) const;
+      bool doLoad(SnapshotReader& in, const uint32_t& procCount);
+
+    private:
+      static int classOf(const long& size) {return 63 - __builtin_clzll(size);}
+      long roundUp(const long& size) const {return size <= 0 ? m_minBlock : (size + m_minBlock - 1) / m_minBlock * m_minBlock;}
+
+      void addFree(long offset, long size);
+      void removeFree(long offset, long size); // by value, callers pass the fields of the entry being erased
+
+      long m_minBlock;
+      bool m_bestFit;
+      PoolMap<long, long> m_free;                    // Free blocks by offset, for merging
+      AddressTree m_byAddress;                       // First fit, the free blocks
+      vector<PoolSet<pair<long, long> > > m_classes; // Best fit, the free blocks in each size class as (size, offset)
+      unsigned long long m_nonEmpty;                 // Bit c is set when class c has a free block
+      PoolMultiset<long> m_freeSizes;                // Sizes of all free blocks, for the largest one
+      vector<pair<long, long> > m_blockOf;           // Offset and size of the block held by each process, size 0 if none
+};
+
+// Virtual memory. Every process gets its memoryRequired in pages of address space when it is admitted, so
+// admission never fails, and the machine's memory is a pool of frames the pages of all the processes compete
+// for. A running process touches one page every time step it runs, see reference, and a page that isn't in a
+// frame is a page fault: the process blocks until the page has been swapped in, and first swapped out whatever
+// it replaces if that was written to. Frames are only given back when a process is done, blocking doesn't take
+// its pages away. Replacement is LRU, CLOCK or 2Q, each O(1) a reference
+class PagedMemory : public MemoryAllocator
+{
+    public:
+      PagedMemory(const MemConfig& config);
+
+      // Address space is never short, only frames are, so anything short of an absurd number of pages is fine
+      bool canHold(const long& size) const;
+      bool fitsBeside(const long&, const vector<uint32_t>&) const {return true;}
+      long largestFree() const {return m_totalMemory - reserved();} // Any frame holds any page so nothing is fragmented, negative when overcommitted
+      void printState(const ProcessTable& procTable) const;
+      void printReport(const string& name) const;
+
+      // Process p, with workload id id and running at the given MLFQ level, is about to run its tick'th time
+      // step at time. Returns 0 if the page it touches is in memory, otherwise the time steps it has to wait
+      // for the page fault to be served. The time step after a fault is the faulting reference carried out,
+      // whatever happened to the page while the process waited, so even a thrashing process gets somewhere
+      long reference(const uint32_t& p, const unsigned int& id, const long& tick, const int& level, const long& time);
+
+      // p is done, its frames are free for the others
+      void processDone(const uint32_t& p);
+
+      unsigned int swapDevice() const {return m_swapDevice;}
+
+    protected:
+      long doAllocate(const uint32_t& p, const long& size);
+      long doRelease(const uint32_t& p);
+      void doSave(SnapshotWriter& out) const;
+      bool doLoad(SnapshotReader& in, const uint32_t& procCount);
+
+    private:
+      static const uint32_t noPage = 0xFFFFFFFF;
+      static const uint32_t noFrame = 0xFFFFFFFF;
+      enum FrameList { recentList, firstList, noList }; // LRU and 2Q's Am, 2Q's A1in, CLOCK keeps frames on neither
+
+      // Counters of the references made at one level, the window ones are for the thrashing window going on now
+      struct LevelStats
+      {
+          LevelStats() : references(0), faults(0), swapIns(0), swapOuts(0), windowReferences(0), windowFaults(0),
+                         activeWindows(0), thrashingWindows(0), firstThrashing(-1) {}
+
+          long references;
+          long faults;
+          long swapIns;
+          long swapOuts;
+          long windowReferences;
+          long windowFaults;
+          long activeWindows;     // Windows with enough references to tell whether the level was thrashing
+          long thrashingWindows;
+          long firstThrashing;    // Start of the first thrashing window, -1 if there wasn't one
+      };
+
+      uint32_t pageOf(const uint32_t& p, const unsigned int& id, const long& tick, bool& write) const;
+      void closeWindows(const long& time);
+      bool active(const LevelStats& stats) const;
+      bool thrashing(const LevelStats& stats) const;
+
+      // The replacement policy's side of a reference
+      void touched(const uint32_t& frame);
+      void loaded(const uint32_t& frame);
+      uint32_t victim();
+      void forget(const uint32_t& frame);
+
+      void pushFront(const int& list, const uint32_t& frame);
+      void unlink(const uint32_t& frame);
+
+      long m_pageSize;
+      Replacement m_replacement;
+      long m_workingSet;
+      long m_swapTime;
+      unsigned int m_swapDevice;
+      uint32_t m_firstInLimit;                 // 2Q's Kin and Kout, the most frames on A1in before it gives up one
+      uint32_t m_ghostLimit;                   // of its own and the most pages A1out remembers
+
+      vector<uint32_t> m_firstPage;            // Each process's first page, its pages are numbered on from it, noPage until it is admitted
+      vector<uint32_t> m_pageCount;
+      vector<uint32_t> m_spanStart;            // The page numbers each slot has, the process in it numbers its pages
+      vector<uint32_t> m_spanPages;            // from the start of them if they are enough, so numbers get reused
+      vector<uint8_t> m_holds;                 // Whether the process is resident, i.e. admitted and not blocked or done
+      vector<uint8_t> m_faulted;               // Whether the process's last reference faulted
+
+      vector<uint32_t> m_frameOf;              // The frame each page is in, noFrame if it is swapped out
+      vector<uint32_t> m_ghost;                // 2Q, the stamp of the page's entry on A1out, 0 if it has none
+
+      vector<uint32_t> m_page;                 // The page in each frame, noPage if it is free
+      vector<uint8_t> m_dirty;                 // Written to since it was swapped in
+      vector<uint8_t> m_referenced;            // CLOCK's reference bits
+      vector<uint8_t> m_list;                  // The FrameList each frame is on
+      vector<uint32_t> m_next;                 // Links of the lists, front to back
+      vector<uint32_t> m_prev;
+      uint32_t m_head[2];
+      uint32_t m_tail[2];
+      uint32_t m_length[2];
+      vector<uint32_t> m_free;                 // Free frames, the last one is used first
+      uint32_t m_hand;                         // CLOCK's hand
+
+      deque<pair<uint32_t, uint32_t> > m_ghosts; // 2Q's A1out, pages and stamps oldest first. An entry whose stamp
+      uint32_t m_ghostStamp;                     // isn't the page's any more is stale and just waits to fall off
+
+      vector<LevelStats> m_levels;
+      long m_windowEnd;                        // Last time step of the thrashing window going on now
+};
+
+// Builds the allocator described by config, its free lists live in arena
+unique_ptr<MemoryAllocator> makeAllocator(const MemConfig& config, Arena& arena);
+
+#endif
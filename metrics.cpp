@@ -0,0 +1,388 @@
+#include "metrics.h"
+
+#include <algorithm>  //for sort
+#include <iomanip>
+
+bool parseMetricsFormat(const string& name, MetricsFormat& format)
+{
+    if(name == "human")
+    {
+        format = humanMetrics;
+    }
+    else if(name == "csv")
+    {
+        format = csvMetrics;
+    }
+    else if(name == "json")
+    {
+        format = jsonMetrics;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+MetricSummary::MetricSummary(vector<long> values) : count(values.size()), mean(0), p50(0), p95(0), p99(0), max(0)
+{
+    if(values.empty())
+    {
+        return;
+    }
+
+    sort(values.begin(), values.end());
+    double sum = 0;
+    for(size_t i = 0; i < values.size(); i++)
+    {
+        sum += values[i];
+    }
+    mean = sum / count;
+
+    // nearest rank
+    p50 = values[(count * 50 + 99) / 100 - 1];
+    p95 = values[(count * 95 + 99) / 100 - 1];
+    p99 = values[(count * 99 + 99) / 100 - 1];
+    max = values.back();
+}
+
+void Metrics::record(const long& time, const vector<StateChange>& changes, const ProcessTable& procTable)
+{
+    for(size_t i = 0; i < changes.size(); i++)
+    {
+        const StateChange& change = changes[i];
+        uint32_t p = change.p;
+        if(change.from == newArrival && change.to == newArrival) // joined the process table, maybe in a slot that was used before
+        {
+            if(p >= m_since.size())
+            {
+                m_since.resize(p + 1);
+                m_entryLevel.resize(p + 1);
+                m_arrival.resize(p + 1);
+                m_outcome.resize(p + 1);
+            }
+            m_since[p] = time;
+            m_entryLevel[p] = 0;
+            m_arrival[p] = procTable.arrivalTime[p];
+            m_outcome[p] = Outcome();
+        }
+
+        Outcome& outcome = m_outcome[p];
+        long spent = time - m_since[p];
+        int level = m_entryLevel[p];
+        if(size_t(max(level, procTable.level[p])) >= m_levels.size())
+        {
+            m_levels.resize(max(level, procTable.level[p]) + 1);
+        }
+
+        switch(change.from)
+        {
+            case ready:
+                outcome.readyTicks += spent;
+                m_levels[level].readyTicks += spent;
+                break;
+            case processing:
+                m_levels[level].runTicks += spent;
+                break;
+            case blocked:
+                outcome.blockedTicks += spent;
+                if(--m_blockedNow == 0)
+                {
+                    m_ioBusyTicks += time - m_ioBusySince;
+                }
+                break;
+            case memBlocked:
+                outcome.memBlockedTicks += spent;
+                break;
+            default:
+                break;
+        }
+
+        level = procTable.level[p];
+        switch(change.to)
+        {
+            case ready:
+                m_levels[level].readyVisits++;
+                break;
+            case processing:
+                m_levels[level].dispatches++;
+                if(outcome.response == -1)
+                {
+                    outcome.response = time - m_arrival[p];
+                }
+                break;
+            case done:
+                outcome.turnaround = time - m_arrival[p];
+                m_finished.push_back(outcome);
+                break;
+            case blocked:
+                if(m_blockedNow++ == 0)
+                {
+                    m_ioBusySince = time;
+                }
+                break;
+            default:
+                break;
+        }
+
+        m_since[p] = time;
+        m_entryLevel[p] = level;
+    }
+}
+
+void Metrics::finish(const long& time, const vector<long>& busyTicks)
+{
+    m_time = time;
+    m_busyTicks = busyTicks;
+}
+
+vector<Metrics::Outcome> Metrics::outcomes() const
+{
+    vector<Outcome> outcomes(m_finished);
+    for(size_t p = 0; p < m_outcome.size(); p++)
+    {
+        if(m_outcome[p].turnaround == -1)
+        {
+            outcomes.push_back(m_outcome[p]);
+        }
+    }
+    return outcomes;
+}
+
+vector<pair<string, MetricSummary> > Metrics::summaries() const
+{
+    // -1 marks a process that didn't get that far
+    vector<long> turnaround, response, readyTicks, blockedTicks, memBlockedTicks;
+    vector<Outcome> outcomes = this->outcomes();
+    for(size_t i = 0; i < outcomes.size(); i++)
+    {
+        if(outcomes[i].turnaround != -1)
+        {
+            turnaround.push_back(outcomes[i].turnaround);
+        }
+        if(outcomes[i].response != -1)
+        {
+            response.push_back(outcomes[i].response);
+        }
+        readyTicks.push_back(outcomes[i].readyTicks);
+        blockedTicks.push_back(outcomes[i].blockedTicks);
+        memBlockedTicks.push_back(outcomes[i].memBlockedTicks);
+    }
+
+    vector<pair<string, MetricSummary> > summaries;
+    summaries.push_back(make_pair("turnaround", MetricSummary(turnaround)));
+    summaries.push_back(make_pair("response", MetricSummary(response)));
+    summaries.push_back(make_pair("readyWait", MetricSummary(readyTicks)));
+    summaries.push_back(make_pair("blocked", MetricSummary(blockedTicks)));
+    summaries.push_back(make_pair("memBlocked", MetricSummary(memBlockedTicks)));
+    return summaries;
+}
+
+double Metrics::cpuUtilization() const
+{
+    long busy = 0;
+    for(size_t c = 0; c < m_busyTicks.size(); c++)
+    {
+        busy += m_busyTicks[c];
+    }
+    return m_time > 0 && !m_busyTicks.empty() ? double(busy) / m_time / m_busyTicks.size() : 0.0;
+}
+
+void Metrics::print(ostream& out, const MetricsFormat& format) const
+{
+    vector<pair<string, MetricSummary> > summaries = this->summaries();
+
+    switch(format)
+    {
+        case humanMetrics:
+            printHuman(out, summaries);
+            break;
+        case csvMetrics:
+            printCsv(out, summaries);
+            break;
+        case jsonMetrics:
+            printJson(out, summaries);
+            break;
+    }
+}
+
+void Metrics::printHuman(ostream& out, const vector<pair<string, MetricSummary> >& summaries) const
+{
+    double ticks = m_time > 0 ? m_time : 1;
+
+    out << "Metrics:" << endl;
+    out << left << setw(12) << "metric" << right << setw(12) << "mean" << setw(10) << "p50" << setw(10) << "p95"
+        << setw(10) << "p99" << setw(10) << "max" << endl;
+    for(size_t i = 0; i < summaries.size(); i++)
+    {
+        const MetricSummary& summary = summaries[i].second;
+        out << left << setw(12) << summaries[i].first << right << fixed << setprecision(2) << setw(12) << summary.mean
+            << setw(10) << summary.p50 << setw(10) << summary.p95 << setw(10) << summary.p99 << setw(10) << summary.max << endl;
+    }
+
+    out << left << setw(12) << "level" << right << setw(12) << "dispatches" << setw(10) << "run" << setw(10) << "ready"
+        << setw(14) << "mean ready" << endl;
+    for(size_t level = m_levels.size(); level-- > 0;)
+    {
+        const Level& stats = m_levels[level];
+        if(stats.dispatches == 0 && stats.readyVisits == 0)
+        {
+            continue;
+        }
+        out << left << setw(12) << level << right << setw(12) << stats.dispatches << setw(10) << stats.runTicks
+            << setw(10) << stats.readyTicks << setw(14) << setprecision(2)
+            << (stats.readyVisits > 0 ? double(stats.readyTicks) / stats.readyVisits : 0.0) << endl;
+    }
+
+    for(size_t c = 0; c < m_busyTicks.size(); c++)
+    {
+        out << "CPU " << c << ": utilization " << setprecision(1) << 100.0 * m_busyTicks[c] / ticks << "%, idle "
+            << m_time - m_busyTicks[c] << " time steps" << endl;
+    }
+    out << "IO: utilization " << 100.0 * m_ioBusyTicks / ticks << "%, busy " << m_ioBusyTicks << " time steps" << endl;
+}
+
+void Metrics::printCsv(ostream& out, const vector<pair<string, MetricSummary> >& summaries) const
+{
+    // one table after another, each with its own header line and a blank line between them
+    out << "metric,count,mean,p50,p95,p99,max" << endl;
+    for(size_t i = 0; i < summaries.size(); i++)
+    {
+        const MetricSummary& summary = summaries[i].second;
+        out << summaries[i].first << ',' << summary.count << ',' << fixed << setprecision(4) << summary.mean << ','
+            << summary.p50 << ',' << summary.p95 << ',' << summary.p99 << ',' << summary.max << endl;
+    }
+
+    out << endl << "level,dispatches,run_ticks,ready_visits,ready_ticks" << endl;
+    for(size_t level = 0; level < m_levels.size(); level++)
+    {
+        const Level& stats = m_levels[level];
+        out << level << ',' << stats.dispatches << ',' << stats.runTicks << ',' << stats.readyVisits << ',' << stats.readyTicks << endl;
+    }
+
+    out << endl << "resource,busy_ticks,idle_ticks,utilization" << endl;
+    for(size_t c = 0; c < m_busyTicks.size(); c++)
+    {
+        out << "cpu" << c << ',' << m_busyTicks[c] << ',' << m_time - m_busyTicks[c] << ',' << setprecision(6)
+            << (m_time > 0 ? double(m_busyTicks[c]) / m_time : 0.0) << endl;
+    }
+    out << "io," << m_ioBusyTicks << ',' << m_time - m_ioBusyTicks << ',' << (m_time > 0 ? double(m_ioBusyTicks) / m_time : 0.0) << endl;
+}
+
+void Metrics::printJson(ostream& out, const vector<pair<string, MetricSummary> >& summaries) const
+{
+    out << "{" << endl << "  \"timeSteps\": " << m_time << "," << endl << "  \"metrics\": {" << endl;
+    for(size_t i = 0; i < summaries.size(); i++)
+    {
+        const MetricSummary& summary = summaries[i].second;
+        out << "    \"" << summaries[i].first << "\": {\"count\": " << summary.count << ", \"mean\": " << fixed << setprecision(4)
+            << summary.mean << ", \"p50\": " << summary.p50 << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99
+            << ", \"max\": " << summary.max << "}" << (i + 1 < summaries.size() ? "," : "") << endl;
+    }
+
+    out << "  }," << endl << "  \"levels\": [" << endl;
+    for(size_t level = 0; level < m_levels.size(); level++)
+    {
+        const Level& stats = m_levels[level];
+        out << "    {\"level\": " << level << ", \"dispatches\": " << stats.dispatches << ", \"runTicks\": " << stats.runTicks
+            << ", \"readyVisits\": " << stats.readyVisits << ", \"readyTicks\": " << stats.readyTicks << "}"
+            << (level + 1 < m_levels.size() ? "," : "") << endl;
+    }
+
+    out << "  ]," << endl << "  \"cpus\": [" << endl;
+    for(size_t c = 0; c < m_busyTicks.size(); c++)
+    {
+        out << "    {\"busyTicks\": " << m_busyTicks[c] << ", \"idleTicks\": " << m_time - m_busyTicks[c] << "}"
+            << (c + 1 < m_busyTicks.size() ? "," : "") << endl;
+    }
+    out << "  ]," << endl << "  \"io\": {\"busyTicks\": " << m_ioBusyTicks << "}" << endl << "}" << endl;
+}
+
+void Metrics::save(SnapshotWriter& out) const
+{
+    out.putUnsigned(m_since.size());
+    for(size_t p = 0; p < m_since.size(); p++)
+    {
+        out.put(m_since[p]);
+        out.put(m_entryLevel[p]);
+        out.put(m_arrival[p]);
+        saveOutcome(out, m_outcome[p]);
+    }
+    out.putUnsigned(m_finished.size());
+    for(size_t i = 0; i < m_finished.size(); i++)
+    {
+        saveOutcome(out, m_finished[i]);
+    }
+
+    out.putUnsigned(m_levels.size());
+    for(size_t level = 0; level < m_levels.size(); level++)
+    {
+        out.put(m_levels[level].dispatches);
+        out.put(m_levels[level].runTicks);
+        out.put(m_levels[level].readyVisits);
+        out.put(m_levels[level].readyTicks);
+    }
+
+    out.put(m_blockedNow);
+    out.put(m_ioBusySince);
+    out.put(m_ioBusyTicks);
+}
+
+bool Metrics::load(SnapshotReader& in)
+{
+    size_t count = in.getCount();
+    m_since.resize(count);
+    m_entryLevel.resize(count);
+    m_arrival.resize(count);
+    m_outcome.resize(count);
+    for(size_t p = 0; p < count && in.good(); p++)
+    {
+        m_since[p] = in.get();
+        m_entryLevel[p] = in.get();
+        m_arrival[p] = in.get();
+        m_outcome[p] = loadOutcome(in);
+    }
+    for(uint64_t n = in.getCount(); n > 0 && in.good(); n--)
+    {
+        m_finished.push_back(loadOutcome(in));
+    }
+
+    m_levels.resize(in.getCount());
+    for(size_t level = 0; level < m_levels.size(); level++)
+    {
+        m_levels[level].dispatches = in.get();
+        m_levels[level].runTicks = in.get();
+        m_levels[level].readyVisits = in.get();
+        m_levels[level].readyTicks = in.get();
+    }
+
+    for(size_t p = 0; p < count; p++)
+    {
+        in.check(m_entryLevel[p] >= 0 && size_t(m_entryLevel[p]) < m_levels.size());
+    }
+
+    m_blockedNow = in.get();
+    m_ioBusySince = in.get();
+    m_ioBusyTicks = in.get();
+    return in.good();
+}
+
+void Metrics::saveOutcome(SnapshotWriter& out, const Outcome& outcome)
+{
+    out.put(outcome.turnaround);
+    out.put(outcome.response);
+    out.put(outcome.readyTicks);
+    out.put(outcome.blockedTicks);
+    out.put(outcome.memBlockedTicks);
+}
+
+Metrics::Outcome Metrics::loadOutcome(SnapshotReader& in)
+{
+    Outcome outcome;
+    outcome.turnaround = in.get();
+    outcome.response = in.get();
+    outcome.readyTicks = in.get();
+    outcome.blockedTicks = in.get();
+    outcome.memBlockedTicks = in.get();
+    return outcome;
+}
@@ -0,0 +1,119 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include<vector>
+#include<string>
+#include<iostream>
+using namespace std;
+
+#include "process.h"
+#include "processIndex.h"
+#include "snapshot.h"
+
+enum MetricsFormat { humanMetrics, csvMetrics, jsonMetrics };
+
+// Parses the name of a metrics format as given on the command line, returns false if it isn't one
+bool parseMetricsFormat(const string& name, MetricsFormat& format);
+
+// Mean, percentiles and maximum of one metric over all processes
+struct MetricSummary
+{
+    MetricSummary(vector<long> values);
+
+    size_t count;
+    double mean;
+    long p50;
+    long p95;
+    long p99;
+    long max;
+};
+
+// Scheduling quality measured from the state changes of the processes. Every change costs O(1), the time a
+// process spends in a state is added up when it leaves it, so nothing has to be recomputed from a trace
+//   turnaround    arrival to completion, what the end of run "Wait Times" show
+//   response      arrival to first being dispatched
+//   ready wait    time spent ready on a run queue
+//   blocked       time spent waiting for IO
+//   memBlocked    time spent waiting for memory
+// Time in the ready and processing states is also broken down by the level the process had when it entered
+// the state, for MLFQ that is the queue it waited on and the level it ran at
+class Metrics
+{
+    public:
+      Metrics() : m_blockedNow(0), m_ioBusySince(0), m_ioBusyTicks(0), m_time(0) {}
+
+      // Called with the state changes of every simulated time step
+      void record(const long& time, const vector<StateChange>& changes, const ProcessTable& procTable);
+
+      // Called once the run is over, time is the last time step and busyTicks holds the time steps each
+      // processor spent running a process
+      void finish(const long& time, const vector<long>& busyTicks);
+
+      void print(ostream& out, const MetricsFormat& format) const;
+
+      // The per process metrics by name: turnaround, response, readyWait, blocked and memBlocked
+      vector<pair<string, MetricSummary> > summaries() const;
+
+      // Busy time steps over all time steps, averaged over the processors
+      double cpuUtilization() const;
+
+      long time() const {return m_time;}
+
+      // Writes what has been measured so far to a snapshot, and reads it back into metrics that haven't recorded
+      // anything yet. load returns false if the snapshot doesn't fit
+      void save(SnapshotWriter& out) const;
+      bool load(SnapshotReader& in);
+
+    private:
+      struct Level
+      {
+          Level() : dispatches(0), runTicks(0), readyVisits(0), readyTicks(0) {}
+
+          long dispatches;
+          long runTicks;
+          long readyVisits;
+          long readyTicks;
+      };
+
+      // The per process figures, turnaround is -1 until the process is done and response until it is first
+      // dispatched
+      struct Outcome
+      {
+          Outcome() : turnaround(-1), response(-1), readyTicks(0), blockedTicks(0), memBlockedTicks(0) {}
+
+          long turnaround;
+          long response;
+          long readyTicks;
+          long blockedTicks;
+          long memBlockedTicks;
+      };
+
+      // The figures of every process, the finished ones and then the ones still alive
+      vector<Outcome> outcomes() const;
+
+      static void saveOutcome(SnapshotWriter& out, const Outcome& outcome);
+      static Outcome loadOutcome(SnapshotReader& in);
+
+      void printHuman(ostream& out, const vector<pair<string, MetricSummary> >& summaries) const;
+      void printCsv(ostream& out, const vector<pair<string, MetricSummary> >& summaries) const;
+      void printJson(ostream& out, const vector<pair<string, MetricSummary> >& summaries) const;
+
+      // Per process, indexed like the process table and started over when a process joins it in a slot
+      vector<long> m_since;         // Time step the process entered its current state
+      vector<int> m_entryLevel;     // Level it had then
+      vector<long> m_arrival;       // Arrival time from the workload
+      vector<Outcome> m_outcome;    // The slot's process is alive while its turnaround is -1
+
+      vector<Outcome> m_finished;   // Moved out of the slots as processes finish, in that order
+
+      vector<Level> m_levels;
+
+      long m_blockedNow;            // Processes waiting on IO right now
+      long m_ioBusySince;
+      long m_ioBusyTicks;           // Time steps with at least one IO request outstanding
+
+      long m_time;
+      vector<long> m_busyTicks;
+};
+
+#endif
@@ -1,41 +1,50 @@
-#include "process.h"
-
-void printProcessStates(list<Process>& processVector)
-{
-    char stateChar;
-    for(auto & Proc : processVector)
-    {
-        switch (Proc.state)
-        {
-            case ready:
-                stateChar = 'r';
-                break;
-            case processing:
-                stateChar = 'p';
-                break;
-            case blocked:
-                stateChar = 'b';
-                break;
-            case newArrival:
-                stateChar = 'n';
-                break;
-            case done:
-                stateChar = 'd';
-                break;
-            case memBlocked:
-                stateChar = 'm';
-                break;
-        }
-        cout << stateChar << ' ';
-    }
-    // cout << endl;
-}
-
-void printProcessSet(vector<Process>& processVector)
-{
-    cout << "AT | DT | RQPT | PT | S | IO" << endl;
-    for(auto & Proc : processVector)
-    {
-        Proc.printProcess();
-    }
-}
+#include "process.h"
+
+char stateChar(const State& state)
+{
+    switch (state)
+    {
+        case ready:
+            return 'r';
+        case processing:
+            return 'p';
+        case blocked:
+            return 'b';
+        case newArrival:
+            return 'n';
+        case done:
+            return 'd';
+        case memBlocked:
+            return 'm';
+    }
+    return '?';
+}
+
+void printProcessStates(const vector<State>& states)
+{
+    for(size_t p = 0, p_end = states.size(); p < p_end; ++p)
+    {
+        cout << stateChar(states[p]) << ' ';
+    }
+    // cout << endl;
+}
+
+void printProcessSet(const ProcessTable& table)
+{
+    cout << "AT | DT | RQPT | PT | S | IO" << endl;
+    for(uint32_t p = 0, p_end = table.size(); p < p_end; ++p)
+    {
+        cout << setw(2) << table.arrivalTime[p] << " |";
+        cout << setw(3) << table.results[table.result[p]].doneTime << " |";
+        cout << setw(5) << table.reqProcessorTime[p] << " |";
+        cout << setw(3) << table.processorTime[p] << " |"; 
+        cout << setw(2) << table.state[p] << " |";
+
+        for (const IOEvent* e = table.ioNext[p]; e != table.ioEnd[p]; ++e)
+        {
+            cout << " " << e->time << ", " << e->duration << ";";
+        }
+
+        cout << endl;
+    }
+}
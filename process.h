@@ -1,83 +1,170 @@
-/*
-
-Relationship between IOEvent::time and Process time:
-
-IOEvent::time represents the number of time steps into a process execution that
-an IO Event will occur. This value will be relative to Process::processorTime.
-
-For example, if a Process has an IOEvent with a time value of 10, then that means 
-that when the process hits it's 10th time step (i.e., Process::processorTime = 10)
-it should enter a blocked state for IOEvent::duration time steps.
-
-*/
-
-#pragma once
-
-#include<iostream>
-#include<list>
-#include<vector>
-#include<sstream>
-#include<fstream>
-#include<iomanip>
-
-using namespace std;
-
-struct IOEvent
-{
-    IOEvent() :  id(9999999), time(-1), duration(0) {};
-    IOEvent(const int& t, const int& d, const unsigned int& newId) : id(newId), time(t), duration(d)  {}
-
-    unsigned int id;
-
-    long time;       // The time the event occurs during the process execution
-    long duration;   // The duration that the process will be Blocked by this IOEvent
-};
-
-enum State { ready, processing, blocked, newArrival, done, memBlocked }; // Used to track the process states
-
-struct Process
-{
-    Process() : id(999999), arrivalTime(-1), doneTime(-1), reqProcessorTime(0), processorTime(0), state(newArrival) {
-    }
-
-    unsigned int id;        // The process ID, assigned when the process is admitted to the system
-
-    long arrivalTime;       // When the process will start/become runnable
-    long doneTime;          // Convenience variable, use this to keep track of when a process completes
-    long reqProcessorTime;  // Total amount of processor time needed
-    long processorTime;     // Amount of processor given to this process
-
-
-    //New------------
-    int timeUsedThisQuantum = 0;
-    int memoryRequired;
-    int level = 3;
-    //New------------
-
-    State state; // State of the process
-
-    list<IOEvent> ioEvents;  // The IO events for this process, stored in order of the time into the process execution that they start 
-
-    void printProcess()
-    {
-        cout << setw(2) << arrivalTime << " |";
-        cout << setw(3) << doneTime << " |";
-        cout << setw(5) << reqProcessorTime << " |";
-        cout << setw(3) << processorTime << " |"; 
-        cout << setw(2) << state << " |";
-
-        for (auto & event : ioEvents)
-        {
-            cout << " " << event.time << ", " << event.duration << ";";
-        }
-
-        cout << endl;
-    }
-};
-
-// Print the state of all the processes in the vector
-void printProcessStates(list<Process>& processVector);
-
-// Print all information about all processes from a vector (debugging function)
-void printProcessSet(vector<Process>& processVector);
-
+/*
+
+Relationship between IOEvent::time and Process time:
+
+IOEvent::time represents the number of time steps into a process execution that
+an IO Event will occur. This value will be relative to Process::processorTime.
+
+For example, if a Process has an IOEvent with a time value of 10, then that means 
+that when the process hits it's 10th time step (i.e., Process::processorTime = 10)
+it should enter a blocked state for IOEvent::duration time steps.
+
+*/
+
+#pragma once
+
+#include<iostream>
+#include<list>
+#include<vector>
+#include<sstream>
+#include<fstream>
+#include<iomanip>
+#include<cstdint>
+
+using namespace std;
+
+struct IOEvent
+{
+    IOEvent() :  id(9999999), device(0), time(-1), duration(0) {};
+    IOEvent(const int& t, const int& d, const unsigned int& newId, const unsigned int& dev = 0) : id(newId), device(dev), time(t), duration(d)  {}
+
+    unsigned int id;
+    unsigned int device;    // The device the request goes to, see IOModule
+
+    long time;       // The time the event occurs during the process execution
+    long duration;   // The duration that the process will be Blocked by this IOEvent
+};
+
+enum State { ready, processing, blocked, newArrival, done, memBlocked }; // Used to track the process states
+
+// A process as described by the workload file, before it is activated
+struct Process
+{
+    Process() : id(999999), arrivalTime(-1), reqProcessorTime(0), memoryRequired(0), ioBegin(0), ioEnd(0) {
+    }
+
+    unsigned int id;        // The process ID, assigned when the process is admitted to the system
+
+    long arrivalTime;       // When the process will start/become runnable
+    long reqProcessorTime;  // Total amount of processor time needed
+    int memoryRequired;
+
+    unsigned int ioBegin;   // The IO events for this process are [ioBegin, ioEnd) of the array they are stored in, usually
+    unsigned int ioEnd;     // Workload::ioEvents(), in order of the time into the process execution that they start
+};
+
+// Marks "no process" wherever a process table index is expected
+const uint32_t noProcess = 0xFFFFFFFF;
+
+// Marks a process that isn't on a LevelQueue, in ProcessTable::queueNext and queuePrev
+const uint32_t notQueued = 0xFFFFFFFE;
+
+// What is kept of a process once it is done, for the end of run reports
+struct ProcessResult
+{
+    ProcessResult(const unsigned int& i, const long& arrival) : id(i), arrivalTime(arrival), doneTime(-1) {}
+
+    unsigned int id;
+    long arrivalTime;
+    long doneTime;          // When the process completed, -1 until it has
+};
+
+// The active processes stored as a struct of arrays. Processes are indexed by a dense 32 bit slot, and the slot
+// of a process that is done is handed to the next one activated once the state changes of the time step it
+// finished on have been handed on, so the table only grows with the number of processes alive at once. What
+// the reports need of every process is kept in results, in the order they were activated, which is also the
+// order processes are printed in. The fields touched on every tick sit in their own contiguous arrays. The IO
+// events stay wherever they were stored, each process keeps a cursor to its next one
+struct ProcessTable
+{
+    // ioEvents is the array proc.ioBegin and proc.ioEnd index, it has to outlive the table
+    inline uint32_t add(const Process& proc, const IOEvent* ioEvents)
+    {
+        uint32_t p;
+        if(unused.empty())
+        {
+            p = state.size();
+            state.push_back(newArrival);
+            level.push_back(3);
+            processorTime.push_back(0);
+            timeUsedThisQuantum.push_back(0);
+            ioNext.push_back(ioEvents + proc.ioBegin);
+            cpu.push_back(-1);
+            policyData.push_back(0);
+            queueNext.push_back(notQueued);
+            queuePrev.push_back(notQueued);
+
+            id.push_back(proc.id);
+            arrivalTime.push_back(proc.arrivalTime);
+            reqProcessorTime.push_back(proc.reqProcessorTime);
+            memoryRequired.push_back(proc.memoryRequired);
+            ioEnd.push_back(ioEvents + proc.ioEnd);
+            result.push_back(results.size());
+        }
+        else
+        {
+            p = unused.back();
+            unused.pop_back();
+            state[p] = newArrival;
+            level[p] = 3;
+            processorTime[p] = 0;
+            timeUsedThisQuantum[p] = 0;
+            ioNext[p] = ioEvents + proc.ioBegin;
+            cpu[p] = -1;
+            policyData[p] = 0;
+            queueNext[p] = notQueued;
+            queuePrev[p] = notQueued;
+
+            id[p] = proc.id;
+            arrivalTime[p] = proc.arrivalTime;
+            reqProcessorTime[p] = proc.reqProcessorTime;
+            memoryRequired[p] = proc.memoryRequired;
+            ioEnd[p] = ioEvents + proc.ioEnd;
+            result[p] = results.size();
+        }
+        results.push_back(ProcessResult(proc.id, proc.arrivalTime));
+        return p;
+    }
+
+    // Process p is done and nothing refers to its slot any more, the next process added can have it
+    inline void release(const uint32_t& p) {unused.push_back(p);}
+
+    // Slots in the table, the unused ones included
+    inline uint32_t size() const {return state.size();}
+
+    inline bool hasIOEvent(const uint32_t& p) const {return ioNext[p] != ioEnd[p];}
+
+    // The next IO event process p will hit, only valid if hasIOEvent(p)
+    inline const IOEvent& nextIOEvent(const uint32_t& p) const {return *ioNext[p];}
+
+    // Hot, read or written on every tick
+    vector<State> state;                  // State of the process, done for an unused slot
+    vector<int> level;
+    vector<long> processorTime;           // Amount of processor given to this process
+    vector<int> timeUsedThisQuantum;
+    vector<const IOEvent*> ioNext;        // The next IO event of the process
+    vector<int> cpu;                      // The processor the process last ran on or was admitted by
+    vector<long> policyData;              // Belongs to the scheduling policy, e.g. the stride pass
+    vector<uint32_t> queueNext;           // Links of the run queue level the process is on, see LevelQueue
+    vector<uint32_t> queuePrev;
+    vector<size_t> result;                // Where the process is in results, i.e. how many were activated before it
+
+    // Cold
+    vector<unsigned int> id;              // The process ID from the workload
+    vector<long> arrivalTime;
+    vector<long> reqProcessorTime;
+    vector<int> memoryRequired;
+    vector<const IOEvent*> ioEnd;         // One past the last IO event of the process
+
+    vector<uint32_t> unused;              // Slots of processes that are done, the last one is reused first
+    vector<ProcessResult> results;        // Every process activated so far, in that order
+};
+
+// The letter a state is printed as
+char stateChar(const State& state);
+
+// Print the states of processes, e.g. every process activated so far in activation order
+void printProcessStates(const vector<State>& states);
+
+// Print all information about all processes from a table (debugging function)
+void printProcessSet(const ProcessTable& table);
@@ -0,0 +1,181 @@
+#ifndef PROCESS_INDEX_H
+#define PROCESS_INDEX_H
+
+#include<vector>
+#include<deque>
+#include<set>
+using namespace std;
+
+#include "process.h"
+#include "arena.h"
+#include "levelQueue.h"
+
+// A change of state of one process. A process joining the process table shows up as a change from
+// newArrival to newArrival
+struct StateChange
+{
+    uint32_t p;
+    State from;
+    State to;
+};
+
+// Keeps the active processes indexed by state so that the scheduler never has to walk the whole process
+// table. Every state change has to go through setState() to keep the index up to date, which also lets the index
+// log the changes made since the last call to clearChanges()
+class ProcessIndex
+{
+    public:
+      ProcessIndex(ProcessTable& procTable, Arena& arena) :
+          m_procTable(procTable), m_blockedCount(0), m_alloc(arena), m_arrivals(m_alloc) {}
+
+      // Called once for every process as it is added to the process table, in the order they are activated
+      inline void activated(const uint32_t& p)
+      {
+        StateChange change = {p, m_procTable.state[p], m_procTable.state[p]};
+        m_changes.push_back(change);
+        if(m_procTable.state[p] == newArrival)
+        {
+            m_arrivals.push_back(p);
+        }
+      }
+
+      inline void setState(const uint32_t& p, const State& state)
+      {
+        if(m_procTable.state[p] != state)
+        {
+            StateChange change = {p, m_procTable.state[p], state};
+            m_changes.push_back(change);
+        }
+
+        switch(m_procTable.state[p])
+        {
+            case newArrival:
+                m_arrivals.pop_front(); // arrivals are always let in oldest first
+                break;
+            case ready:
+                removeReady(p);
+                break;
+            case blocked:
+                --m_blockedCount;
+                break;
+            default:
+                break;
+        }
+
+        m_procTable.state[p] = state;
+
+        switch(state)
+        {
+            case ready:
+                addReady(p);
+                break;
+            case blocked:
+                ++m_blockedCount;
+                break;
+            default:
+                break;
+        }
+      }
+
+      // Every level change of a process that may be ready has to go through here
+      inline void setLevel(const uint32_t& p, const int& level)
+      {
+        bool isReady = m_procTable.state[p] == ready;
+        if(isReady)
+        {
+            removeReady(p);
+        }
+        m_procTable.level[p] = level;
+        if(isReady)
+        {
+            addReady(p);
+        }
+      }
+
+      // The oldest process still waiting to be admitted, or noProcess
+      inline uint32_t nextArrival() const {return m_arrivals.empty() ? noProcess : m_arrivals.front();}
+
+      // Process p if it is blocked, otherwise noProcess
+      inline uint32_t blockedProcess(const uint32_t& p) const
+      {
+        return p < m_procTable.size() && m_procTable.state[p] == blocked ? p : noProcess;
+      }
+
+      inline bool anyBlocked() const {return m_blockedCount != 0;}
+      inline int blockedCount() const {return m_blockedCount;}
+
+      // Ready processes on level, levels go from 0 to levelCount() - 1
+      inline int levelCount() const {return m_ready.size();}
+      inline size_t readyCount(const int& level) const {return m_ready[level].size();}
+
+      // The ready process on the lowest level, the earliest activated if there is a tie, or noProcess
+      inline uint32_t lowestPriorityReady() const
+      {
+        return m_readyLevels.any() ? m_ready[m_readyLevels.lowest()].begin()->second : noProcess;
+      }
+
+      // Indexes every process in the table as it is, for a table that was filled in directly, e.g. from a snapshot
+      inline void rebuild()
+      {
+        m_arrivals.clear();
+        m_ready.clear();
+        m_readyLevels.reset();
+        m_blockedCount = 0;
+        m_changes.clear();
+        for(uint32_t p = 0; p < m_procTable.size(); p++)
+        {
+            switch(m_procTable.state[p])
+            {
+                case newArrival:
+                    m_arrivals.push_back(p);
+                    break;
+                case ready:
+                    addReady(p);
+                    break;
+                case blocked:
+                    ++m_blockedCount;
+                    break;
+                default:
+                    break;
+            }
+        }
+      }
+
+      // The state changes since the last clearChanges(), in the order they happened
+      inline const vector<StateChange>& changes() const {return m_changes;}
+      inline void clearChanges() {m_changes.clear();}
+
+    private:
+      inline void addReady(const uint32_t& p)
+      {
+        int level = m_procTable.level[p];
+        if(size_t(level) >= m_ready.size())
+        {
+            m_ready.resize(level + 1, PoolSet<pair<size_t, uint32_t> >(m_alloc));
+            m_readyLevels.resize(level + 1);
+        }
+        m_ready[level].insert(make_pair(m_procTable.result[p], p));
+        m_readyLevels.set(level);
+      }
+
+      inline void removeReady(const uint32_t& p)
+      {
+        int level = m_procTable.level[p];
+        m_ready[level].erase(make_pair(m_procTable.result[p], p));
+        if(m_ready[level].empty())
+        {
+            m_readyLevels.clear(level);
+        }
+      }
+
+      ProcessTable& m_procTable;
+      int m_blockedCount;
+
+      PoolAllocator<uint32_t> m_alloc;
+      PoolDeque<uint32_t> m_arrivals;       // processes in newArrival, oldest first
+      vector<PoolSet<pair<size_t, uint32_t> > > m_ready; // ready processes per level as (result, p), in activation order
+      LevelBitmap m_readyLevels;            // the levels of m_ready that have anything on them
+      vector<StateChange> m_changes;    // state changes not yet handed on, e.g. to the trace
+};
+
+#endif
@@ -1,64 +1,302 @@
 #include "processMgmt.h"
 
-void ProcessManagement::readProcessFile(const string& fname)
+#include <algorithm>  //for stable_sort
+
+const vector<uint32_t>& ProcessManagement::activateProcesses(const long& time)
 {
-    stringstream ss;
-    ifstream in(fname.c_str());
-    string line, strItem;
-    Process proc;
-    unsigned int ioIDctrl(0), procIDctrl(0);
-    int ioTime, ioDur;
+    m_activated.clear();
 
-    m_pending.clear();
+    // whatever the feed has that's arrived by now joins the added processes
+    long arrival;
+    while(m_feed != nullptr && m_feed->peek(arrival) && arrival <= time)
+    {
+        Process proc;
+        vector<IOEvent> ioEvents;
+        m_feed->take(proc, ioEvents);
+        addArrival(proc, ioEvents);
+    }
 
-    if(!in.good())
+    // anything that arrived on a time step that was skipped over is let in as well
+    while(true)
     {
-        cerr << "initProcessSetFromFile error     unable to open file \"" << fname << "\"" << endl;
-        return;
+        bool fromWorkload = m_next != m_workload.size() && m_workload.arrivalTime(m_next) <= time;
+        if(!m_added.empty() && m_added.top().proc.arrivalTime <= time
+           && (!fromWorkload || m_added.top().proc.arrivalTime < m_workload.arrivalTime(m_next)))
+        {
+            m_addedAt.push_back(m_procTable.results.size());
+            m_activated.push_back(m_procTable.add(m_added.top().proc, m_added.top().ioEvents));
+            m_added.pop();
+        }
+        else if(fromWorkload)
+        {
+            m_activated.push_back(m_procTable.add(m_workload.process(m_next), m_workload.ioEvents()));
+            ++m_next;
+        }
+        else
+        {
+            break;
+        }
     }
 
-    m_pending.reserve(20);
+    // the workload's processes are activated in workload order, so once all the ones before m_retired are done
+    // the pages of a mapped workload they were read from aren't needed any more
+    while(m_retired < m_procTable.results.size() && m_procTable.results[m_retired].doneTime != -1)
+    {
+        if(!m_addedAt.empty() && m_addedAt.front() == m_retired)
+        {
+            m_addedAt.pop_front();
+            ++m_retiredAdded;
+        }
+        ++m_retired;
+    }
+    if(m_retired - m_retiredAdded - m_released >= releaseBatch)
+    {
+        m_workload.release(m_released, m_retired - m_retiredAdded);
+        m_released = m_retired - m_retiredAdded;
+    }
 
-    while(getline(in, line))
+    return m_activated;
+}
+
+void ProcessManagement::addArrival(const Process& proc, const vector<IOEvent>& ioEvents)
+{
+    m_addedEvents.push_back(ioEvents);
+    vector<IOEvent>& events = m_addedEvents.back();
+    if(!is_sorted(events.begin(), events.end(), ioComp))
     {
-        ss.clear();
-        ss.str(line);
+        stable_sort(events.begin(), events.end(), ioComp);
+    }
 
-        sleep(1);
-        srand(time(NULL));
-        proc.memoryRequired = (rand() + 1) % 256;
+    Process added(proc);
+    added.ioBegin = 0;
+    added.ioEnd = events.size();
+    m_added.push(Arrival(added, events.data(), m_addedCount));
+    ++m_addedCount;
+}
 
-        proc.id = procIDctrl;
-        ++procIDctrl;
+long ProcessManagement::nextArrivalTime()
+{
+    long next = m_next == m_workload.size() ? -1 : m_workload.arrivalTime(m_next);
+    if(!m_added.empty() && (next == -1 || m_added.top().proc.arrivalTime < next))
+    {
+        next = m_added.top().proc.arrivalTime;
+    }
+    long arrival;
+    if(m_feed != nullptr && m_feed->peek(arrival) && (next == -1 || arrival < next))
+    {
+        next = arrival;
+    }
+    return next;
+}
 
-        ss >> proc.arrivalTime;
+void ProcessManagement::save(SnapshotWriter& out) const
+{
+    out.putUnsigned(m_workload.size());
+    out.putUnsigned(m_workload.ioEventCount());
+    out.putUnsigned(m_next);
+    out.putUnsigned(m_retired);
+    out.putUnsigned(m_retiredAdded);
+    out.putUnsigned(m_released);
 
-        ss >> proc.reqProcessorTime;
+    // the IO events of a workload process are its place in the workload, an added process takes the ones it has left along
+    uintptr_t workloadEvents = reinterpret_cast<uintptr_t>(m_workload.ioEvents());
+    uintptr_t workloadEventsEnd = reinterpret_cast<uintptr_t>(m_workload.ioEvents() + m_workload.ioEventCount());
+    out.putUnsigned(m_procTable.results.size());
+    for(size_t r = 0; r < m_procTable.results.size(); r++)
+    {
+        out.putUnsigned(m_procTable.results[r].id);
+        out.put(m_procTable.results[r].arrivalTime);
+        out.put(m_procTable.results[r].doneTime);
+    }
+    out.putUnsigned(m_procTable.size());
+    for(uint32_t p = 0; p < m_procTable.size(); p++)
+    {
+        out.putUnsigned(m_procTable.state[p]);
+        out.put(m_procTable.level[p]);
+        out.put(m_procTable.processorTime[p]);
+        out.put(m_procTable.timeUsedThisQuantum[p]);
+        out.put(m_procTable.cpu[p]);
+        out.put(m_procTable.policyData[p]);
+        out.putUnsigned(m_procTable.id[p]);
+        out.put(m_procTable.arrivalTime[p]);
+        out.put(m_procTable.reqProcessorTime[p]);
+        out.put(m_procTable.memoryRequired[p]);
+        out.putUnsigned(m_procTable.result[p]);
 
-        proc.ioEvents.clear();
-        while(ss >> ioTime)
+        uintptr_t next = reinterpret_cast<uintptr_t>(m_procTable.ioNext[p]);
+        if(!m_procTable.hasIOEvent(p))
         {
-            ss >> ioDur;
-
-            proc.ioEvents.push_back(IOEvent(ioTime, ioDur, ioIDctrl));
-            ++ioIDctrl;
+            out.putUnsigned(0);
         }
-        proc.ioEvents.sort(ioComp);
+        else if(next >= workloadEvents && next < workloadEventsEnd)
+        {
+            out.putUnsigned(1);
+            out.putUnsigned(m_procTable.ioNext[p] - m_workload.ioEvents());
+            out.putUnsigned(m_procTable.ioEnd[p] - m_workload.ioEvents());
+        }
+        else
+        {
+            out.putUnsigned(2);
+            saveEvents(out, m_procTable.ioNext[p], m_procTable.ioEnd[p]);
+        }
+    }
+    out.putUnsigned(m_procTable.unused.size());
+    for(size_t i = 0; i < m_procTable.unused.size(); i++)
+    {
+        out.putUnsigned(m_procTable.unused[i]);
+    }
 
-        m_pending.push_back(proc);
+    out.putUnsigned(m_addedAt.size());
+    for(size_t i = 0; i < m_addedAt.size(); i++)
+    {
+        out.putUnsigned(m_addedAt[i]);
     }
 
-    sort(m_pending.begin(), m_pending.end(), procComp);
+    out.putUnsigned(m_addedCount);
+    priority_queue<Arrival, vector<Arrival>, greater<Arrival> > added(m_added);
+    out.putUnsigned(added.size());
+    for(; !added.empty(); added.pop())
+    {
+        const Arrival& arrival = added.top();
+        out.putUnsigned(arrival.seq);
+        out.putUnsigned(arrival.proc.id);
+        out.put(arrival.proc.arrivalTime);
+        out.put(arrival.proc.reqProcessorTime);
+        out.put(arrival.proc.memoryRequired);
+        saveEvents(out, arrival.ioEvents + arrival.proc.ioBegin, arrival.ioEvents + arrival.proc.ioEnd);
+    }
 }
 
-void ProcessManagement::activateProcesses(const int& time)
+bool ProcessManagement::load(SnapshotReader& in)
 {
-    if(m_pending.size() > 0)
+    uint64_t size = in.getUnsigned();
+    uint64_t eventCount = in.getUnsigned();
+    if(size != m_workload.size() || eventCount != m_workload.ioEventCount())
+    {
+        return false; // leaves the reader good, it isn't damaged
+    }
+    m_next = in.getUnsigned();
+    m_retired = in.getUnsigned();
+    m_retiredAdded = in.getUnsigned();
+    m_released = in.getUnsigned();
+    in.check(m_next <= m_workload.size());
+
+    vector<ProcessResult> results;
+    for(uint64_t n = in.getCount(); n > 0 && in.good(); n--)
+    {
+        unsigned int id = in.getUnsigned();
+        long arrivalTime = in.get();
+        results.push_back(ProcessResult(id, arrivalTime));
+        results.back().doneTime = in.get();
+    }
+
+    vector<size_t> result;
+    for(uint64_t n = in.getCount(); n > 0 && in.good(); n--)
+    {
+        Process proc;
+        State state = State(in.getIndex(memBlocked + 1));
+        int level = in.get();
+        long processorTime = in.get();
+        int timeUsedThisQuantum = in.get();
+        int cpu = in.get();
+        long policyData = in.get();
+        proc.id = in.getUnsigned();
+        proc.arrivalTime = in.get();
+        proc.reqProcessorTime = in.get();
+        proc.memoryRequired = in.get();
+        result.push_back(in.getIndex(results.size()));
+
+        const IOEvent* ioEvents = nullptr;
+        uint64_t where = in.getIndex(3);
+        if(where == 1)
+        {
+            ioEvents = m_workload.ioEvents();
+            proc.ioBegin = in.getUnsigned();
+            proc.ioEnd = in.getUnsigned();
+            in.check(proc.ioBegin <= proc.ioEnd && proc.ioEnd <= m_workload.ioEventCount());
+        }
+        else if(where == 2)
+        {
+            uint64_t count;
+            ioEvents = loadEvents(in, count);
+            proc.ioEnd = count;
+        }
+        if(!in.good())
+        {
+            break;
+        }
+
+        uint32_t p = m_procTable.add(proc, ioEvents);
+        m_procTable.state[p] = state;
+        m_procTable.level[p] = level;
+        m_procTable.processorTime[p] = processorTime;
+        m_procTable.timeUsedThisQuantum[p] = timeUsedThisQuantum;
+        m_procTable.cpu[p] = cpu;
+        m_procTable.policyData[p] = policyData;
+    }
+    // every slot was new to the table as it was read back, so they are where they were saved
+    m_procTable.results.swap(results);
+    for(uint32_t p = 0; p < m_procTable.size() && in.good(); p++)
     {
-        while(m_pending.back().arrivalTime == time)
+        m_procTable.result[p] = result[p];
+    }
+    for(uint64_t n = in.getCount(); n > 0 && in.good(); n--)
+    {
+        uint32_t p = in.getIndex(m_procTable.size());
+        if(in.check(m_procTable.state[p] == done))
         {
-            m_procList.push_back(m_pending.back());
-            m_pending.pop_back();
+            m_procTable.unused.push_back(p);
         }
     }
-}
\ No newline at end of file
+    in.check(m_retired <= m_procTable.results.size() && m_retiredAdded <= m_retired && m_released <= m_retired - m_retiredAdded
+             && m_retired - m_retiredAdded <= m_next);
+
+    for(uint64_t n = in.getCount(); n > 0; n--)
+    {
+        m_addedAt.push_back(in.getIndex(m_procTable.results.size()));
+    }
+
+    m_addedCount = in.getUnsigned();
+    for(uint64_t n = in.getCount(); n > 0 && in.good(); n--)
+    {
+        Process proc;
+        unsigned long seq = in.getUnsigned();
+        proc.id = in.getUnsigned();
+        proc.arrivalTime = in.get();
+        proc.reqProcessorTime = in.get();
+        proc.memoryRequired = in.get();
+        uint64_t count;
+        const IOEvent* ioEvents = loadEvents(in, count);
+        proc.ioBegin = 0;
+        proc.ioEnd = count;
+        m_added.push(Arrival(proc, ioEvents, seq));
+    }
+    return in.good();
+}
+
+void ProcessManagement::saveEvents(SnapshotWriter& out, const IOEvent* begin, const IOEvent* end) const
+{
+    out.putUnsigned(end - begin);
+    for(const IOEvent* e = begin; e != end; ++e)
+    {
+        out.putUnsigned(e->id);
+        out.putUnsigned(e->device);
+        out.put(e->time);
+        out.put(e->duration);
+    }
+}
+
+const IOEvent* ProcessManagement::loadEvents(SnapshotReader& in, uint64_t& count)
+{
+    count = in.getCount();
+    m_addedEvents.push_back(vector<IOEvent>(count));
+    vector<IOEvent>& events = m_addedEvents.back();
+    for(size_t i = 0; i < count; i++)
+    {
+        events[i].id = in.getUnsigned();
+        events[i].device = in.getUnsigned();
+        events[i].time = in.get();
+        events[i].duration = in.get();
+    }
+    return events.data();
+}
@@ -2,40 +2,94 @@
 #define PROCESS_MGMT_H
 
 #include<vector>
-#include<algorithm>  //for sort
-#include<cstdlib>
-#include<ctime>
-#include <unistd.h>
+#include<deque>
+#include<queue>       //for priority_queue
+#include<functional>  //for greater
 using namespace std;
 
 #include "process.h"
+#include "workload.h"
+#include "snapshot.h"
 
-inline bool procComp(const Process& p1, const Process& p2)
+// A process added while the simulation runs, waiting for its arrival time. Ordered by arrival time and then by
+// the order they were added in
+struct Arrival
 {
-    return p1.arrivalTime > p2.arrivalTime;
-}
+    Arrival(const Process& p, const IOEvent* e, const unsigned long& s) : proc(p), ioEvents(e), seq(s) {}
 
-inline bool ioComp(const IOEvent& e1, const IOEvent& e2)
-{
-    return e1.time < e2.time;
-}
+    bool operator>(const Arrival& other) const
+    {
+        return proc.arrivalTime > other.proc.arrivalTime || (proc.arrivalTime == other.proc.arrivalTime && seq > other.seq);
+    }
 
+    Process proc;
+    const IOEvent* ioEvents;    // The array proc.ioBegin and proc.ioEnd index
+    unsigned long seq;
+};
 
 class ProcessManagement
 {
     public:
-      ProcessManagement(list<Process>& procList) : m_procList(procList) {};
+      // Processes from feed, if there is one, are let in on top of the workload as they are read
+      ProcessManagement(ProcessTable& procTable, const Workload& workload, ArrivalFeed* feed = nullptr) :
+          m_workload(workload), m_next(0), m_feed(feed), m_addedCount(0), m_retired(0), m_retiredAdded(0), m_released(0), m_procTable(procTable)
+      {
+        m_procTable.results.reserve(workload.size());
+      }
+
+      // Let in every process that has arrived by this time, returns the slots of the process table they were
+      // given, in the order they were let in. Processes from the workload and ones that were added are let in by
+      // arrival time, the workload's first when they arrive on the same time step
+      const vector<uint32_t>& activateProcesses(const long& time);
+
+      // Adds a process to the ones still to come, without touching the workload. One whose arrival time has
+      // already gone by is let in on the next time step. ioEvents are proc's IO events, proc.ioBegin and
+      // proc.ioEnd are ignored
+      void addArrival(const Process& proc, const vector<IOEvent>& ioEvents);
+
+      bool moreProcessesComing()
+      {
+        long arrival;
+        return m_next != m_workload.size() || !m_added.empty() || (m_feed != nullptr && m_feed->peek(arrival));
+      }
+
+      // Arrival time of the next process to be activated, or -1 if there are none left
+      long nextArrivalTime();
 
-      void readProcessFile(const string& fname);
+      // Whether processes are being read from a feed, a snapshot can't hold what it hasn't read yet
+      bool following() const {return m_feed != nullptr;}
 
-      void activateProcesses(const int& time);
+      // Writes the process table, its results and how far through the workload and the added processes the run
+      // is to a snapshot
+      void save(SnapshotWriter& out) const;
 
-      bool moreProcessesComing() {return m_pending.size() != 0;}
+      // Reads back what save wrote into an empty process table. Returns false if the snapshot doesn't fit, with
+      // in still good if it was saved from another workload
+      bool load(SnapshotReader& in);
 
     private:
-      vector<Process> m_pending;
+      static const size_t releaseBatch = 4096;
+
+      void saveEvents(SnapshotWriter& out, const IOEvent* begin, const IOEvent* end) const;
+
+      // Reads IO events written by saveEvents into storage of their own, returns where they are
+      const IOEvent* loadEvents(SnapshotReader& in, uint64_t& count);
+
+      const Workload& m_workload;
+      size_t m_next;        // The next process of the workload to be activated
+
+      ArrivalFeed* m_feed;
+      priority_queue<Arrival, vector<Arrival>, greater<Arrival> > m_added; // Added processes still to come
+      deque<vector<IOEvent> > m_addedEvents;    // Their IO events, which don't move once they are here
+      unsigned long m_addedCount;
+      deque<size_t> m_addedAt;                  // Where the added processes that aren't retired are in the results
+      vector<uint32_t> m_activated;             // Slots let in by the last activateProcesses
+
+      size_t m_retired;     // Every process before this one in the process table's results is done
+      size_t m_retiredAdded; // How many of those were added rather than from the workload
+      size_t m_released;    // The workload has been told it can drop the processes before this one
 
-      list<Process>& m_procList;
+      ProcessTable& m_procTable;
 };
 
-#endif
\ No newline at end of file
+#endif
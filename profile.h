@@ -0,0 +1,258 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include<vector>
+#include<string>
+#include<iostream>
+#include<fstream>
+#include<iomanip>
+#include<cstdint>
+#include<chrono>
+using namespace std;
+
+#ifdef SIM_PROFILE
+#if defined(__x86_64__) || defined(__i386__)
+#include<x86intrin.h> //for __rdtsc
+#endif
+#endif
+
+// The parts of a time step the profiler times, each one runs inside another, see Simulator::step
+//   step        a whole simulated time step
+//   skip        working out how far event mode can jump ahead
+//   update      the schedulers' timers, e.g. the MLFQ boost
+//   activate    letting arrivals into the process table and the index
+//   io          IOModule::ioProcessing
+//   run         a processor carrying on with its running process, including IO requests and completion
+//   admit       a processor admitting a new arrival
+//   interrupt   a processor handling an IO interrupt
+//   dispatch    a processor picking, stealing and making room in memory for its next process
+//   output      the trace sink
+//   metrics     recording the state changes for the metrics
+enum ProfilePhase { stepPhase, skipPhase, updatePhase, activatePhase, ioPhase, runPhase, admitPhase, interruptPhase,
+                    dispatchPhase, outputPhase, metricsPhase, phaseCount };
+
+inline const char* phaseName(const ProfilePhase& phase)
+{
+    static const char* names[phaseCount] = {"step", "skip", "update", "activate", "io", "run", "admit", "interrupt",
+                                            "dispatch", "output", "metrics"};
+    return names[phase];
+}
+
+// Queues whose lengths are sampled after every simulated time step
+enum ProfileQueue { blockedQueue, ioPendingQueue, readyQueue };
+
+#ifdef SIM_PROFILE
+
+// Counts how often each phase runs and the time it takes, with the time stamp counter where there is one and
+// the monotonic clock in nanoseconds where there isn't. Phases are kept in a tree of where they were called
+// from, so every path has its own self time and they can be written out as folded stacks for a flame graph.
+// Also keeps a histogram of the length of each sampled queue, in power of two buckets. Built in only with
+// SIM_PROFILE defined, otherwise every call is an empty inline function, see make profile
+class Profiler
+{
+    public:
+      static const bool enabled = true;
+
+      Profiler() : m_nodes(1), m_depth(0) {}
+
+      inline void enter(const ProfilePhase& phase)
+      {
+        int parent = m_depth == 0 ? 0 : m_stack[m_depth - 1].node;
+        int node = m_nodes[parent].children[phase];
+        if(node == 0) { // first time down this path
+          node = m_nodes.size();
+          m_nodes[parent].children[phase] = node;
+          m_nodes.push_back(Node());
+          m_nodes.back().phase = phase;
+          m_nodes.back().parent = parent;
+        }
+        Frame& frame = m_stack[m_depth++];
+        frame.node = node;
+        frame.children = 0;
+        frame.start = now();
+      }
+
+      inline void leave()
+      {
+        Frame& frame = m_stack[--m_depth];
+        uint64_t elapsed = now() - frame.start;
+        Node& node = m_nodes[frame.node];
+        node.calls++;
+        node.total += elapsed;
+        node.self += elapsed - frame.children;
+        if(m_depth > 0) {
+          m_stack[m_depth - 1].children += elapsed;
+        }
+      }
+
+      // level only counts for the ready queue, which has one histogram per level
+      inline void sample(const ProfileQueue& queue, const size_t& length, const int& level = 0)
+      {
+        size_t index = queue == readyQueue ? readyQueue + level : queue;
+        if(index >= m_histograms.size()) {
+          m_histograms.resize(index + 1, vector<long>(bucketCount, 0));
+        }
+        m_histograms[index][length == 0 ? 0 : 64 - __builtin_clzll(length)]++;
+      }
+
+      static const char* unit()
+      {
+#if defined(__x86_64__) || defined(__i386__)
+        return "cycles";
+#else
+        return "ns";
+#endif
+      }
+
+      // Calls, total and self time of every phase, added up over every path it was called on, then the queue
+      // length histograms
+      void printReport(ostream& out) const
+      {
+        vector<long> calls(phaseCount, 0);
+        vector<uint64_t> total(phaseCount, 0), self(phaseCount, 0);
+        for(size_t n = 1; n < m_nodes.size(); n++) {
+          calls[m_nodes[n].phase] += m_nodes[n].calls;
+          total[m_nodes[n].phase] += m_nodes[n].total;
+          self[m_nodes[n].phase] += m_nodes[n].self;
+        }
+
+        out << "Profile (" << unit() << "):" << endl;
+        out << setw(10) << "phase" << setw(12) << "calls" << setw(16) << "total" << setw(16) << "self" << setw(12) << "per call" << endl;
+        for(int phase = 0; phase < phaseCount; phase++) {
+          if(calls[phase] == 0) {
+            continue;
+          }
+          out << setw(10) << phaseName(ProfilePhase(phase)) << setw(12) << calls[phase] << setw(16) << total[phase]
+              << setw(16) << self[phase] << setw(12) << fixed << setprecision(1) << double(total[phase]) / calls[phase] << endl;
+        }
+
+        out << "Queue lengths, time steps at each length:" << endl;
+        out << setw(16) << "queue";
+        size_t buckets = 0;
+        for(size_t q = 0; q < m_histograms.size(); q++) {
+          for(size_t b = 0; b < bucketCount; b++) {
+            if(m_histograms[q][b] != 0) {
+              buckets = max(buckets, b + 1);
+            }
+          }
+        }
+        for(size_t b = 0; b < buckets; b++) {
+          out << setw(12) << bucketName(b);
+        }
+        out << endl;
+        for(size_t q = 0; q < m_histograms.size(); q++) {
+          long samples = 0;
+          for(size_t b = 1; b < bucketCount; b++) {
+            samples += m_histograms[q][b];
+          }
+          if(q >= readyQueue && samples == 0) { // a level nothing was ever ready on
+            continue;
+          }
+          string name = q == blockedQueue ? "blocked" : q == ioPendingQueue ? "IO pending" : "ready level " + to_string(q - readyQueue);
+          out << setw(16) << name;
+          for(size_t b = 0; b < buckets; b++) {
+            out << setw(12) << m_histograms[q][b];
+          }
+          out << endl;
+        }
+      }
+
+      // Writes every path's self time as "step;run 1234" lines, what flamegraph.pl and speedscope read.
+      // Returns false if the file can't be written
+      bool writeFolded(const string& fname) const
+      {
+        ofstream out(fname.c_str());
+        for(size_t n = 1; n < m_nodes.size(); n++) {
+          string path = phaseName(m_nodes[n].phase);
+          for(int p = m_nodes[n].parent; p != 0; p = m_nodes[p].parent) {
+            path = string(phaseName(m_nodes[p].phase)) + ";" + path;
+          }
+          out << path << ' ' << m_nodes[n].self << endl;
+        }
+        out.close();
+        return !out.fail();
+      }
+
+    private:
+      static const int maxDepth = 16;
+      static const size_t bucketCount = 65;
+
+      struct Node
+      {
+          Node() : phase(stepPhase), parent(0), calls(0), total(0), self(0)
+          {
+            for(int c = 0; c < phaseCount; c++) {
+              children[c] = 0;
+            }
+          }
+
+          ProfilePhase phase;
+          int parent;
+          int children[phaseCount];   // Node of each phase called from this one, 0 if it hasn't been yet
+          long calls;
+          uint64_t total;
+          uint64_t self;              // Total less the time spent in the phases called from it
+      };
+
+      struct Frame
+      {
+          int node;
+          uint64_t start;
+          uint64_t children;          // Time spent in the phases called from it so far
+      };
+
+      static inline uint64_t now()
+      {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+      }
+
+      static string bucketName(const size_t& b)
+      {
+        if(b < 2) {
+          return to_string(b);
+        }
+        return to_string(1ULL << (b - 1)) + "-" + to_string((1ULL << (b - 1)) * 2 - 1);
+      }
+
+      vector<Node> m_nodes;               // The tree of paths, node 0 is the root and isn't a phase
+      Frame m_stack[maxDepth];
+      int m_depth;
+      vector<vector<long> > m_histograms; // Indexed by ProfileQueue, the ready queue has one from readyQueue on for each level
+};
+
+#else
+
+// Built without SIM_PROFILE, everything compiles away
+class Profiler
+{
+    public:
+      static const bool enabled = false;
+
+      inline void enter(const ProfilePhase&) {}
+      inline void leave() {}
+      inline void sample(const ProfileQueue&, const size_t&, const int& = 0) {}
+      void printReport(ostream&) const {}
+      bool writeFolded(const string&) const {return false;}
+};
+
+#endif
+
+// Times the phase from here to the end of the scope
+class ProfileScope
+{
+    public:
+      ProfileScope(Profiler& profiler, const ProfilePhase& phase) : m_profiler(profiler) {m_profiler.enter(phase);}
+      ~ProfileScope() {m_profiler.leave();}
+
+      ProfileScope(const ProfileScope&) = delete;
+      ProfileScope& operator=(const ProfileScope&) = delete;
+
+    private:
+      Profiler& m_profiler;
+};
+
+#endif
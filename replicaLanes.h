@@ -0,0 +1,137 @@
+#ifndef REPLICA_LANES_H
+#define REPLICA_LANES_H
+
+#include<vector>
+#include<memory>
+using namespace std;
+
+#include "workload.h"
+#include "memory.h"
+#include "arena.h"
+
+// The replicas of an ensemble that a simulation runs in lockstep, see runEnsemble. Lane 0 is the simulation
+// itself and lane l the same workload with memoryRequired drawn from another seed. Memory is the only thing that
+// differs between them, and it only steers the schedule through whether an allocation succeeds or a process
+// fits, so as long as every lane's allocator answers the way the simulation's did, the lane's run is the
+// simulation's: one clock, processorTime and timeUsedThisQuantum serve all of them and only the memory is kept
+// per lane. A lane whose allocator answers differently has diverged and is dropped, it has to be run on its own.
+// The bytes each lane holds are laid out lane by lane so the updates of a time step are a loop over all lanes
+// the compiler can vectorize, a diverged lane is updated along with the rest and its figures ignored
+class ReplicaLanes
+{
+    public:
+      // workloads[l] is what lane l runs, workloads[0] the simulation's
+      ReplicaLanes(const vector<const Workload*>& workloads, const MemConfig& config) :
+          m_workloads(workloads), m_width(workloads.size()), m_inStep(m_width, 1), m_used(m_width, 0), m_usedTicks(m_width, 0),
+          m_lastTime(1)
+      {
+        m_memory.push_back(nullptr); // lane 0 uses the simulation's
+        for(size_t l = 1; l < m_width; l++) {
+          m_memory.push_back(makeAllocator(config, m_arena));
+        }
+      }
+
+      ReplicaLanes(const ReplicaLanes&) = delete;
+      ReplicaLanes& operator=(const ReplicaLanes&) = delete;
+
+      // Whether lane l still runs the simulation's schedule
+      bool inStep(const size_t& l) const {return m_inStep[l] != 0;}
+
+      // The mean bytes lane l's resident processes asked for over the time steps accounted for
+      double usedMean(const size_t& l) const
+      {
+        return m_lastTime > 1 ? double(m_usedTicks[l]) / (m_lastTime - 1) : 0.0;
+      }
+
+      // Process p was put in slot p as the ordinal'th process of the run
+      inline void activated(const uint32_t& p, const size_t& ordinal)
+      {
+        if(m_required.size() < (p + 1) * m_width) {
+          m_required.resize((p + 1) * m_width, 0);
+        }
+        int* row = &m_required[p * m_width];
+        for(size_t l = 0; l < m_width; l++) {
+          row[l] = m_workloads[l]->process(ordinal).memoryRequired;
+        }
+        for(size_t l = 1; l < m_width; l++) {
+          if(!m_memory[l]->canHold(row[l])) { // On its own it would stop here, which is its run's to report
+            m_inStep[l] = 0;
+          }
+        }
+      }
+
+      // The simulation tried to allocate p's memory, got says whether it did
+      inline void allocated(const uint32_t& p, const bool& got)
+      {
+        const int* row = &m_required[p * m_width];
+        for(size_t l = 1; l < m_width; l++) {
+          if(m_inStep[l] && m_memory[l]->allocate(p, row[l]) != got) {
+            m_inStep[l] = 0;
+          }
+        }
+        if(got) {
+          addRow(row, 1);
+        }
+      }
+
+      // The simulation released p's memory, or evicted p when evicted, had says whether p held any
+      inline void released(const uint32_t& p, const bool& had, const bool& evicted)
+      {
+        if(!had) {
+          return;
+        }
+        const int* row = &m_required[p * m_width];
+        for(size_t l = 1; l < m_width; l++) {
+          if(m_inStep[l] && !(evicted ? m_memory[l]->evict(p) : m_memory[l]->release(p))) {
+            m_inStep[l] = 0;
+          }
+        }
+        addRow(row, -1);
+      }
+
+      // The simulation asked whether p would fit beside kept and fits is its answer
+      inline void checkedFit(const uint32_t& p, const vector<uint32_t>& kept, const bool& fits)
+      {
+        const int* row = &m_required[p * m_width];
+        for(size_t l = 1; l < m_width; l++) {
+          if(m_inStep[l] && m_memory[l]->fitsBeside(row[l], kept) != fits) {
+            m_inStep[l] = 0;
+          }
+        }
+      }
+
+      // Memory looked the way it does now since the last call, as MemoryAllocator::account
+      inline void account(const long& time)
+      {
+        // locals, so the compiler knows the stores leave the bounds alone and vectorizes the loop
+        long ticks = time - m_lastTime;
+        const long* used = m_used.data();
+        long* usedTicks = m_usedTicks.data();
+        for(size_t l = 0, width = m_width; l < width; l++) {
+          usedTicks[l] += used[l] * ticks;
+        }
+        m_lastTime = time;
+      }
+
+    private:
+      // Adds sign times a row of m_required to m_used, with locals for the same reason as account
+      inline void addRow(const int* row, const long& sign)
+      {
+        long* used = m_used.data();
+        for(size_t l = 0, width = m_width; l < width; l++) {
+          used[l] += sign * row[l];
+        }
+      }
+
+      vector<const Workload*> m_workloads;
+      size_t m_width;                                // Lanes, the simulation's included
+      Arena m_arena;                                 // Nodes of the lanes' allocators
+      vector<unique_ptr<MemoryAllocator> > m_memory; // Each lane's allocator, null for lane 0
+      vector<char> m_inStep;                         // Per lane, 1 until it diverges
+      vector<int> m_required;                        // memoryRequired of slot p on lane l at p * m_width + l
+      vector<long> m_used;                           // Per lane, bytes asked for by the processes holding memory
+      vector<long> m_usedTicks;                      // Per lane, m_used summed over the time steps accounted for
+      long m_lastTime;                               // Time of the previous call to account
+};
+
+#endif
@@ -0,0 +1,653 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include<vector>
+#include<deque>
+#include<set>
+#include<string>
+#include<random>
+#include<climits>
+#include<cstdlib>    //for strtol
+#include<iterator>    //for prev
+#include<sstream>
+using namespace std;
+
+#include "process.h"
+#include "processIndex.h"
+#include "arena.h"
+#include "snapshot.h"
+#include "levelQueue.h"
+
+/*
+
+Scheduling policies
+
+Every policy is a class with the members below. The Simulator is instantiated once per policy as a
+template, so these calls are resolved (and usually inlined) at compile time rather than made through a
+virtual table. A policy is made with Scheduler(procTable, index, config, arena) and keeps its run queue in
+the arena of the simulation.
+
+  void admit(p)            p is a new arrival, give it its starting level and put it on the run queue
+  void enqueue(p)          put p back on the run queue, after an interrupt or when its quantum ran out
+  uint32_t pickNext()      take the next process to run off the run queue, noProcess if it is empty
+  uint32_t steal()         take the process that would run last off the run queue for another processor,
+                           noProcess if it is empty
+  bool empty()             nothing on the run queue
+  long size()              number of processes on the run queue
+  long quantum(p)          how long p may run before it has to give up the processor
+  void quantumExpired(p)   p used up its quantum, called before it is enqueued again
+  void update(time)        called at the start of every simulated time step, before anything else happens
+  void save(out)           write the run queue and anything else the policy keeps to a snapshot
+  bool load(in, time)      read back what save wrote, into a scheduler made for the process table the snapshot
+                           was restored to. time is the time step the snapshot was taken on. Returns false if
+                           the snapshot doesn't fit
+
+There is one scheduler per processor and processes move between them, so anything a policy keeps per process
+has to go in ProcessTable::policyData rather than in the scheduler. Processes on the run queue may be ready or
+memBlocked. Levels work as they always have, the highest level
+is the highest priority and level 1 is the lowest. A policy that changes the level of a process that may be
+ready has to go through ProcessIndex::setLevel so the eviction index stays correct.
+
+*/
+
+enum Policy { mlfqPolicy, roundRobinPolicy, srtfPolicy, lotteryPolicy, stridePolicy };
+
+// The most MLFQ levels there can be, the binary trace keeps a level in a byte with 255 for no process
+const int maxLevels = 254;
+
+struct SchedConfig
+{
+    SchedConfig() : policy(mlfqPolicy), levels(0), boostPeriod(0), tickets(100), seed(0) {quanta = {16, 32, 64};}
+
+    Policy policy;
+    int levels;             // MLFQ levels, 0 means one per quantum given
+    vector<long> quanta;    // MLFQ quantum of each level from the top down, the other policies use the first one
+    long boostPeriod;       // MLFQ moves every process back to the top level this often, 0 means never
+    long tickets;           // lottery and stride tickets held by every process
+    unsigned int seed;      // lottery draws
+};
+
+// Parses the name of a policy as given on the command line, returns false if it isn't one
+inline bool parsePolicy(const string& name, Policy& policy)
+{
+    if(name == "mlfq") policy = mlfqPolicy;
+    else if(name == "rr") policy = roundRobinPolicy;
+    else if(name == "srtf") policy = srtfPolicy;
+    else if(name == "lottery") policy = lotteryPolicy;
+    else if(name == "stride") policy = stridePolicy;
+    else return false;
+    return true;
+}
+
+// Parses a comma separated list of quanta, top level first, returns false if it isn't one
+inline bool parseQuanta(const string& list, vector<long>& quanta)
+{
+    const char* pos = list.c_str();
+    quanta.clear();
+    do
+    {
+        char* end;
+        quanta.push_back(strtol(pos, &end, 10));
+        if(end == pos)
+        {
+            quanta.clear();
+            return false;
+        }
+        pos = end;
+    } while(*pos++ == ',');
+    if(*(pos - 1) != '\0')
+    {
+        quanta.clear();
+        return false;
+    }
+    return true;
+}
+
+// An entry of a run queue ordered by a key, ties go to whichever process was queued first
+struct RunQueueEntry
+{
+    RunQueueEntry(const long& k, const unsigned long& s, const uint32_t& proc) : key(k), seq(s), p(proc) {}
+
+    bool operator<(const RunQueueEntry& other) const
+    {
+        return key < other.key || (key == other.key && seq < other.seq);
+    }
+
+    long key;
+    unsigned long seq;
+    uint32_t p;
+};
+
+// Writes a run queue of RunQueueEntry to a snapshot, and reads one back for a table of procCount processes
+inline void saveRunQueue(SnapshotWriter& out, const PoolSet<RunQueueEntry>& queue)
+{
+    out.putUnsigned(queue.size());
+    for(PoolSet<RunQueueEntry>::const_iterator it = queue.begin(); it != queue.end(); ++it)
+    {
+        out.put(it->key);
+        out.putUnsigned(it->seq);
+        out.putUnsigned(it->p);
+    }
+}
+
+inline bool loadRunQueue(SnapshotReader& in, PoolSet<RunQueueEntry>& queue, const uint32_t& procCount)
+{
+    for(uint64_t n = in.getCount(); n > 0; n--)
+    {
+        long key = in.get();
+        unsigned long seq = in.getUnsigned();
+        queue.insert(RunQueueEntry(key, seq, in.getIndex(procCount)));
+    }
+    return in.good();
+}
+
+// Multi-level feedback queue: new processes start on the top level, using up a whole quantum moves a process
+// down a level, and every boostPeriod time steps all processes go back to the top. The run queue is a
+// LevelQueue, so picking the next process costs the same with maxLevels levels as with three
+class MLFQScheduler
+{
+    public:
+      MLFQScheduler(ProcessTable& procTable, ProcessIndex& index, const SchedConfig& config, Arena&)
+        : m_procTable(procTable), m_index(index), m_levels(config.levels > 0 ? config.levels : config.quanta.size()),
+          m_quanta(config.quanta), m_queue(procTable, m_levels + 1), m_boostPeriod(config.boostPeriod),
+          m_nextBoost(config.boostPeriod > 0 ? config.boostPeriod : LONG_MAX), m_boosts(0)
+      {
+        // levels without a quantum of their own get twice the one above, until that is longer than any run
+        while(int(m_quanta.size()) < m_levels)
+        {
+            m_quanta.push_back(m_quanta.back() > LONG_MAX / 2 ? LONG_MAX : m_quanta.back() * 2);
+        }
+      }
+
+      inline void admit(const uint32_t& p)
+      {
+        m_procTable.policyData[p] = m_boosts;
+        m_index.setLevel(p, m_levels);
+        enqueue(p);
+      }
+
+      inline void enqueue(const uint32_t& p)
+      {
+        // a process that was blocked or running during a boost is boosted when it comes back. Every processor
+        // boosts at the same time so the count is the same whichever scheduler the process comes back to
+        if(m_procTable.policyData[p] != m_boosts)
+        {
+            m_procTable.policyData[p] = m_boosts;
+            m_index.setLevel(p, m_levels);
+        }
+        m_queue.pushBack(m_procTable.level[p], p);
+      }
+
+      inline uint32_t pickNext() {return m_queue.popHighest();}
+
+      // The back of the lowest level that has anything on it
+      inline uint32_t steal() {return m_queue.popLowest();}
+
+      inline bool empty() const {return m_queue.empty();}
+
+      inline long size() const {return m_queue.size();}
+
+      inline long quantum(const uint32_t& p) const {return m_quanta[m_levels - m_procTable.level[p]];}
+
+      inline void quantumExpired(const uint32_t& p)
+      {
+        if(m_procTable.level[p] > 1)
+        {
+            m_procTable.level[p]--;
+        }
+      }
+
+      inline void update(const long& time)
+      {
+        if(time >= m_nextBoost)
+        {
+            boost();
+            m_nextBoost = (time / m_boostPeriod + 1) * m_boostPeriod;
+        }
+      }
+
+      inline void save(SnapshotWriter& out) const
+      {
+        for(int level = 1; level <= m_levels; level++)
+        {
+            long count = 0;
+            for(uint32_t p = m_queue.front(level); p != noProcess; p = m_queue.next(p))
+            {
+                count++;
+            }
+            out.putUnsigned(count);
+            for(uint32_t p = m_queue.front(level); p != noProcess; p = m_queue.next(p))
+            {
+                out.putUnsigned(p);
+            }
+        }
+        out.put(m_boostPeriod);
+        out.put(m_nextBoost);
+        out.put(m_boosts);
+      }
+
+      inline bool load(SnapshotReader& in, const long& time)
+      {
+        for(int level = 1; level <= m_levels; level++)
+        {
+            for(uint64_t n = in.getCount(); n > 0; n--)
+            {
+                uint32_t p = in.getIndex(m_procTable.size());
+                if(in.check(m_queue.unqueued(p))) // a process queued twice would tie the links in a loop
+                {
+                    m_queue.pushBack(level, p);
+                }
+            }
+        }
+        long boostPeriod = in.get();
+        long nextBoost = in.get();
+        m_boosts = in.get();
+        in.check(boostPeriod > 0 || nextBoost == LONG_MAX);
+
+        // a run resumed with another boost period boosts next on the first multiple of it after the snapshot
+        if(boostPeriod == m_boostPeriod)
+        {
+            m_nextBoost = nextBoost;
+        }
+        else if(m_boostPeriod > 0)
+        {
+            m_nextBoost = (time / m_boostPeriod + 1) * m_boostPeriod;
+        }
+        return in.good();
+      }
+
+    private:
+      // Move everything on the lower queues to the back of the top queue, highest level first
+      inline void boost()
+      {
+        for(int level = m_levels - 1; level > 0; level--)
+        {
+            for(uint32_t p = m_queue.moveAll(level, m_levels); p != noProcess; p = m_queue.next(p))
+            {
+                m_index.setLevel(p, m_levels);
+            }
+        }
+        ++m_boosts;
+      }
+
+      ProcessTable& m_procTable;
+      ProcessIndex& m_index;
+      int m_levels;
+      vector<long> m_quanta;
+      LevelQueue m_queue;                  // run queue of each level, indexed by level, level 0 is never used
+
+      long m_boostPeriod;
+      long m_nextBoost;
+      long m_boosts;                       // number of boosts so far, policyData holds the number each process has had
+};
+
+// Round robin on a single queue with a fixed quantum
+class RoundRobinScheduler
+{
+    public:
+      RoundRobinScheduler(ProcessTable& procTable, ProcessIndex& index, const SchedConfig& config, Arena& arena)
+        : m_procTable(procTable), m_index(index), m_quantum(config.quanta.front()), m_queue(PoolAllocator<uint32_t>(arena)) {}
+
+      inline void admit(const uint32_t& p)
+      {
+        m_index.setLevel(p, 1);
+        enqueue(p);
+      }
+
+      inline void enqueue(const uint32_t& p) {m_queue.push_back(p);}
+
+      inline uint32_t pickNext()
+      {
+        if(m_queue.empty())
+        {
+            return noProcess;
+        }
+        uint32_t p = m_queue.front();
+        m_queue.pop_front();
+        return p;
+      }
+
+      inline uint32_t steal()
+      {
+        if(m_queue.empty())
+        {
+            return noProcess;
+        }
+        uint32_t p = m_queue.back();
+        m_queue.pop_back();
+        return p;
+      }
+
+      inline bool empty() const {return m_queue.empty();}
+
+      inline long size() const {return m_queue.size();}
+
+      inline long quantum(const uint32_t&) const {return m_quantum;}
+
+      inline void quantumExpired(const uint32_t&) {}
+
+      inline void update(const long&) {}
+
+      inline void save(SnapshotWriter& out) const
+      {
+        out.putUnsigned(m_queue.size());
+        for(size_t i = 0; i < m_queue.size(); i++)
+        {
+            out.putUnsigned(m_queue[i]);
+        }
+      }
+
+      inline bool load(SnapshotReader& in, const long&)
+      {
+        for(uint64_t n = in.getCount(); n > 0; n--)
+        {
+            m_queue.push_back(in.getIndex(m_procTable.size()));
+        }
+        return in.good();
+      }
+
+    private:
+      ProcessTable& m_procTable;
+      ProcessIndex& m_index;
+      long m_quantum;
+      PoolDeque<uint32_t> m_queue;
+};
+
+// Shortest remaining time first. A process runs until it blocks or finishes, ties go to whichever process was
+// queued first. Arrivals are only admitted while the processor is idle, so there is nothing to preempt for
+class SRTFScheduler
+{
+    public:
+      SRTFScheduler(ProcessTable& procTable, ProcessIndex& index, const SchedConfig&, Arena& arena)
+        : m_procTable(procTable), m_index(index), m_queued(0), m_queue(PoolAllocator<RunQueueEntry>(arena)) {}
+
+      inline void admit(const uint32_t& p)
+      {
+        m_index.setLevel(p, 1);
+        enqueue(p);
+      }
+
+      inline void enqueue(const uint32_t& p)
+      {
+        m_queue.insert(RunQueueEntry(m_procTable.reqProcessorTime[p] - m_procTable.processorTime[p], m_queued, p));
+        ++m_queued;
+      }
+
+      inline uint32_t pickNext()
+      {
+        if(m_queue.empty())
+        {
+            return noProcess;
+        }
+        uint32_t p = m_queue.begin()->p;
+        m_queue.erase(m_queue.begin());
+        return p;
+      }
+
+      // The process with the most time left
+      inline uint32_t steal()
+      {
+        if(m_queue.empty())
+        {
+            return noProcess;
+        }
+        uint32_t p = m_queue.rbegin()->p;
+        m_queue.erase(prev(m_queue.end()));
+        return p;
+      }
+
+      inline bool empty() const {return m_queue.empty();}
+
+      inline long size() const {return m_queue.size();}
+
+      inline long quantum(const uint32_t&) const {return LONG_MAX;}
+
+      inline void quantumExpired(const uint32_t&) {}
+
+      inline void update(const long&) {}
+
+      inline void save(SnapshotWriter& out) const
+      {
+        out.putUnsigned(m_queued);
+        saveRunQueue(out, m_queue);
+      }
+
+      inline bool load(SnapshotReader& in, const long&)
+      {
+        m_queued = in.getUnsigned();
+        return loadRunQueue(in, m_queue, m_procTable.size());
+      }
+
+    private:
+      ProcessTable& m_procTable;
+      ProcessIndex& m_index;
+      unsigned long m_queued;     // processes queued so far, orders ties
+      PoolSet<RunQueueEntry> m_queue;
+};
+
+// Lottery scheduling: every pick draws a ticket at random from the tickets held by the queued processes.
+// The tickets are kept in a Fenwick tree over the process table so a draw is O(log n)
+class LotteryScheduler
+{
+    public:
+      LotteryScheduler(ProcessTable& procTable, ProcessIndex& index, const SchedConfig& config, Arena&)
+        : m_procTable(procTable), m_index(index), m_quantum(config.quanta.front()), m_tickets(config.tickets), m_rng(config.seed),
+          m_highBit(0), m_total(0), m_queued(0) {}
+
+      inline void admit(const uint32_t& p)
+      {
+        m_index.setLevel(p, 1);
+        enqueue(p);
+      }
+
+      inline void enqueue(const uint32_t& p)
+      {
+        if(p >= m_held.size())
+        {
+            grow(p + 1);
+        }
+        add(p, m_tickets);
+        ++m_queued;
+      }
+
+      inline uint32_t pickNext()
+      {
+        if(m_queued == 0)
+        {
+            return noProcess;
+        }
+
+        // walk down the tree to the process holding the winning ticket
+        long winner = uniform_int_distribution<long>(0, m_total - 1)(m_rng);
+        uint32_t p = 0;
+        for(uint32_t step = m_highBit; step > 0; step >>= 1)
+        {
+            if(p + step <= m_held.size() && m_tree[p + step - 1] <= winner)
+            {
+                p += step;
+                winner -= m_tree[p - 1];
+            }
+        }
+
+        add(p, -m_held[p]); // what it was queued with, a resumed run may hand out a different number
+        --m_queued;
+        return p;
+      }
+
+      // Every process is as likely to be picked last, so a stolen process is drawn like any other
+      inline uint32_t steal() {return pickNext();}
+
+      inline bool empty() const {return m_queued == 0;}
+
+      inline long size() const {return m_queued;}
+
+      inline long quantum(const uint32_t&) const {return m_quantum;}
+
+      inline void quantumExpired(const uint32_t&) {}
+
+      inline void update(const long&) {}
+
+      inline void save(SnapshotWriter& out) const
+      {
+        ostringstream rng;
+        rng << m_rng;
+        out.putString(rng.str());
+        out.putUnsigned(m_held.size());
+        for(size_t p = 0; p < m_held.size(); p++)
+        {
+            out.put(m_held[p]);
+        }
+      }
+
+      inline bool load(SnapshotReader& in, const long&)
+      {
+        istringstream rng(in.getString());
+        rng >> m_rng;
+        uint64_t size = in.getCount();
+        if(!in.check(!rng.fail()) || size == 0)
+        {
+            return in.good();
+        }
+        grow(size); // the same size as when it was saved, so the same draws pick the same processes
+        for(uint32_t p = 0; p < size; p++)
+        {
+            long held = in.get();
+            if(held != 0 && in.check(p < m_procTable.size()))
+            {
+                add(p, held);
+                ++m_queued;
+            }
+        }
+        return in.good();
+      }
+
+    private:
+      inline void add(const uint32_t& p, const long& tickets)
+      {
+        m_held[p] += tickets;
+        m_total += tickets;
+        for(uint32_t i = p + 1; i <= m_held.size(); i += i & (~i + 1))
+        {
+            m_tree[i - 1] += tickets;
+        }
+      }
+
+      // Rebuild the tree for at least size processes, keeping the tickets already in it
+      inline void grow(const uint32_t& size)
+      {
+        vector<long> held(m_held);
+        held.resize(max<uint32_t>(size, m_held.size() * 2), 0);
+
+        m_held.assign(held.size(), 0);
+        m_tree.assign(held.size(), 0);
+        m_total = 0;
+        for(m_highBit = 1; m_highBit * 2 <= m_held.size(); m_highBit *= 2) {}
+        for(uint32_t p = 0; p < held.size(); p++)
+        {
+            if(held[p] != 0)
+            {
+                add(p, held[p]);
+            }
+        }
+      }
+
+      ProcessTable& m_procTable;
+      ProcessIndex& m_index;
+      long m_quantum;
+      long m_tickets;
+      mt19937 m_rng;
+
+      vector<long> m_held;    // tickets held by each process, 0 while it isn't queued
+      vector<long> m_tree;    // Fenwick tree over m_held
+      uint32_t m_highBit;     // highest power of two no larger than the tree
+      long m_total;
+      long m_queued;
+};
+
+// Stride scheduling: the queued process with the lowest pass runs next and its pass goes up by its stride,
+// stride being inversely proportional to its tickets. A process joining the queue starts at the current pass
+// so that time spent blocked isn't banked
+class StrideScheduler
+{
+    public:
+      StrideScheduler(ProcessTable& procTable, ProcessIndex& index, const SchedConfig& config, Arena& arena)
+        : m_procTable(procTable), m_index(index), m_quantum(config.quanta.front()), m_stride(strideOne / config.tickets), m_globalPass(0),
+          m_queued(0), m_queue(PoolAllocator<RunQueueEntry>(arena)) {}
+
+      inline void admit(const uint32_t& p)
+      {
+        m_procTable.policyData[p] = m_globalPass;
+        m_index.setLevel(p, 1);
+        enqueue(p);
+      }
+
+      inline void enqueue(const uint32_t& p)
+      {
+        long& pass = m_procTable.policyData[p];
+        pass = max(pass, m_globalPass);
+        m_queue.insert(RunQueueEntry(pass, m_queued, p));
+        ++m_queued;
+      }
+
+      inline uint32_t pickNext()
+      {
+        if(m_queue.empty())
+        {
+            return noProcess;
+        }
+        uint32_t p = m_queue.begin()->p;
+        m_queue.erase(m_queue.begin());
+        m_globalPass = m_procTable.policyData[p];
+        m_procTable.policyData[p] += m_stride;
+        return p;
+      }
+
+      // The process with the highest pass, it keeps its pass when it moves
+      inline uint32_t steal()
+      {
+        if(m_queue.empty())
+        {
+            return noProcess;
+        }
+        uint32_t p = m_queue.rbegin()->p;
+        m_queue.erase(prev(m_queue.end()));
+        return p;
+      }
+
+      inline bool empty() const {return m_queue.empty();}
+
+      inline long size() const {return m_queue.size();}
+
+      inline long quantum(const uint32_t&) const {return m_quantum;}
+
+      inline void quantumExpired(const uint32_t&) {}
+
+      inline void update(const long&) {}
+
+      inline void save(SnapshotWriter& out) const
+      {
+        out.put(m_globalPass);
+        out.putUnsigned(m_queued);
+        saveRunQueue(out, m_queue);
+      }
+
+      inline bool load(SnapshotReader& in, const long&)
+      {
+        m_globalPass = in.get();
+        m_queued = in.getUnsigned();
+        return loadRunQueue(in, m_queue, m_procTable.size());
+      }
+
+    private:
+      static const long strideOne = 1 << 20;
+
+      ProcessTable& m_procTable;
+      ProcessIndex& m_index;
+      long m_quantum;
+      long m_stride;
+      long m_globalPass;          // policyData holds the pass of each process
+      unsigned long m_queued;     // processes queued so far, orders ties
+      PoolSet<RunQueueEntry> m_queue;
+};
+
+#endif
@@ -0,0 +1,849 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include<vector>
+#include<string>
+#include<list>
+#include<memory>     //for unique_ptr
+#include<climits>
+#include<chrono>     //for sleep
+#include<thread>     //for sleep
+#include<functional> //for function
+using namespace std;
+
+#include "process.h"
+#include "ioModule.h"
+#include "processMgmt.h"
+#include "processIndex.h"
+#include "scheduler.h"
+#include "memory.h"
+#include "trace.h"
+#include "metrics.h"
+#include "snapshot.h"
+#include "profile.h"
+#include "replicaLanes.h"
+
+// How a simulation is set up, apart from the workload it runs
+struct SimConfig
+{
+    SimConfig() : cpuCount(1), eventDriven(false), sleepDuration(0), ioMode(inlineIO), memReport(false), printStats(false) {}
+
+    SchedConfig sched;
+    MemConfig memory;
+    int cpuCount;
+    bool eventDriven;       // discrete-event mode, jump straight to the next time step where something can change
+    long sleepDuration;     // pause after every time step so the output can be watched, in milliseconds
+    IOMode ioMode;          // whether IO completes on this thread or on a device thread of its own
+    vector<DeviceConfig> devices; // the devices IO events go to, none for just the default one
+
+    bool memReport;         // end of run reports, see Simulator::printReports
+    bool printStats;
+};
+
+// Returns why config can't be simulated, or an empty string if it can
+inline string checkConfig(const SimConfig& config)
+{
+    if(config.sched.quanta.empty() || config.sched.levels < 0 || config.sched.boostPeriod < 0 || config.sched.tickets <= 0)
+    {
+        return "invalid scheduling policy options";
+    }
+    for(size_t i = 0; i < config.sched.quanta.size(); i++)
+    {
+        if(config.sched.quanta[i] <= 0)
+        {
+            return "quanta have to be positive";
+        }
+    }
+    if((config.sched.levels > 0 ? size_t(config.sched.levels) : config.sched.quanta.size()) > size_t(maxLevels))
+    {
+        return "there can be at most " + to_string(maxLevels) + " levels";
+    }
+    if(config.cpuCount < 1)
+    {
+        return "there has to be at least one processor";
+    }
+    if(!config.devices.empty() && config.ioMode != inlineIO)
+    {
+        return "devices can only be modelled with inline IO";
+    }
+    if(config.memory.totalMemory <= 0 || config.memory.partitions < 1 || config.memory.minBlock <= 0 || config.memory.minBlock > config.memory.totalMemory)
+    {
+        return "invalid memory options";
+    }
+    if(config.memory.allocator == partitionAllocator && config.memory.totalMemory / config.memory.partitions == 0)
+    {
+        return "there are more partitions than bytes of memory";
+    }
+    if(config.memory.allocator == buddyAllocator && (config.memory.minBlock & (config.memory.minBlock - 1)) != 0)
+    {
+        return "the buddy allocator needs a power of two minimum block";
+    }
+    if(config.memory.allocator == pagedAllocator)
+    {
+        const MemConfig& memory = config.memory;
+        if(memory.pageSize <= 0 || memory.pageSize > memory.totalMemory || memory.totalMemory / memory.pageSize > (1L << 30) ||
+           memory.workingSet < 1 || memory.swapTime < 1)
+        {
+            return "invalid paging options";
+        }
+        if(memory.swapDevice >= max<size_t>(config.devices.size(), 1))
+        {
+            return "the swap device isn't configured, see --device";
+        }
+    }
+    return "";
+}
+
+// Per processor bookkeeping that doesn't depend on the scheduling policy
+struct Cpu
+{
+    Cpu() : runningProcess(noProcess), busyTicks(0), steals(0), migrations(0) {}
+
+    uint32_t runningProcess;    // Current Running Process, as an index into procTable
+    long busyTicks;             // Time steps a process spent running here
+    long steals;                // Processes taken from another processor's run queue
+    long migrations;            // Processes that started running here after last running or being admitted elsewhere
+};
+
+// One run of a workload on cpuCount processors, each with its own run queues ordered by the Scheduler policy.
+// An idle processor with nothing queued steals from the processor with the most queued. All of the state of
+// the run lives in the object and the workload is only read, so any number of simulations can run at the
+// same time, each on its own thread. A program embedding it links libsim.a, see make release, and drives a run
+// with step, runUntil or runToCompletion
+template<class Scheduler>
+class Simulator
+{
+    public:
+      // Processes read from feed, if there is one, arrive on top of the workload's
+      Simulator(const Workload& workload, const SimConfig& config, TraceSink& sink, Metrics* metrics, ArrivalFeed* feed = nullptr) :
+          m_config(config), m_sink(sink), m_metrics(metrics), m_processMgmt(m_procTable, workload, feed),
+          m_interrupts(PoolAllocator<IOInterrupt>(m_arena)), m_ioModule(m_interrupts, config.ioMode, config.devices), m_index(m_procTable, m_arena),
+          m_cpus(config.cpuCount), m_steps(config.cpuCount), m_memory(makeAllocator(config.memory, m_arena)),
+          m_paging(config.memory.allocator == pagedAllocator ? static_cast<PagedMemory*>(m_memory.get()) : nullptr), m_lanes(nullptr), m_time(0), m_runningCount(0),
+          m_queuedCount(0), m_simulatedSteps(0), m_events(0)
+      {
+        m_schedulers.reserve(config.cpuCount);
+        for(int c = 0; c < config.cpuCount; c++) {
+          SchedConfig cpuConfig(config.sched);
+          cpuConfig.seed += c;
+          m_schedulers.push_back(Scheduler(m_procTable, m_index, cpuConfig, m_arena));
+        }
+      }
+
+      // Members refer to each other, so a simulator stays where it was made
+      Simulator(const Simulator&) = delete;
+      Simulator& operator=(const Simulator&) = delete;
+
+      // Run the workload to completion, returns 0, or 1 if it can't be run
+      int runToCompletion()
+      {
+        if(!runUntil(LONG_MAX)) {
+          return 1;
+        }
+        finish();
+        return 0;
+      }
+
+      // Simulate up to the first time step at or after time, or to the end of the run if that comes first. In
+      // event mode that may be a little after time. Returns false if the workload can't be run
+      bool runUntil(const long& time)
+      {
+        //keep running the loop until all processes have been added and have run to completion
+        while(m_time < time && !finished())
+        {
+            if(!step()) {
+              return false;
+            }
+        }
+        return true;
+      }
+
+      // Every process has been added and has run to completion
+      bool finished()
+      {
+        return !(m_processMgmt.moreProcessesComing() || m_queuedCount != 0 || m_index.anyBlocked() || m_runningCount != 0);
+      }
+
+      // Wraps up the run where it is: stops the IO device and hands the end of the run to the trace and the metrics
+      void finish()
+      {
+        m_ioModule.stop();
+        m_sink.finish();
+        m_memory->account(m_time + 1);
+        if(m_lanes != nullptr) {
+          m_lanes->account(m_time + 1);
+        }
+        if(m_metrics != nullptr) {
+          vector<long> busyTicks;
+          for(int c = 0; c < m_config.cpuCount; c++) {
+            busyTicks.push_back(m_cpus[c].busyTicks);
+          }
+          m_metrics->finish(m_time, busyTicks);
+        }
+      }
+
+      // The end of run reports on cout: the wait times, the processors when there is more than one, interrupt
+      // delivery with a device thread, the devices when they are configured, the step counts with printStats, the
+      // profile in a profiling build and the memory summary with memReport
+      void printReports() const
+      {
+        cout << "Wait Times:" << endl;
+        for(size_t r = 0; r < m_procTable.results.size(); r++) {
+          const ProcessResult& result = m_procTable.results[r];
+          cout << "Process ID: " << result.id << ", time: " << result.doneTime - result.arrivalTime << " time ticks" << endl;
+        }
+
+        if(m_config.cpuCount > 1) {
+          cout << "Processors:" << endl;
+          for(int c = 0; c < m_config.cpuCount; c++) {
+            cout << "CPU " << c << ": utilization " << fixed << setprecision(1) << (m_time > 0 ? 100.0 * m_cpus[c].busyTicks / m_time : 0.0)
+                 << "%, migrations " << m_cpus[c].migrations << ", steals " << m_cpus[c].steals << endl;
+          }
+        }
+
+        if(m_ioModule.mode() != inlineIO) {
+          MetricSummary latency(m_ioModule.latencies());
+          cout << "IO device: " << ioModeName(m_ioModule.mode()) << ", interrupts " << latency.count << ", " << fixed << setprecision(1)
+               << m_ioModule.handledPerSecond() << " per second, latency ns mean " << latency.mean << " p50 " << latency.p50
+               << " p99 " << latency.p99 << " max " << latency.max << ", ring full " << m_ioModule.ringFull() << endl;
+        }
+
+        if(!m_config.devices.empty()) {
+          cout << "Devices:" << endl;
+          for(size_t d = 0; d < m_ioModule.deviceCount(); d++) {
+            const DeviceStats& stats = m_ioModule.deviceStats(d);
+            cout << m_ioModule.device(d).name << ": requests " << stats.completed << ", utilization " << fixed << setprecision(1)
+                 << (m_time > 0 ? 100.0 * stats.busyTicks / m_time : 0.0) << "%, in service " << setprecision(2)
+                 << (m_time > 0 ? double(stats.servedTicks) / m_time : 0.0) << ", queueing delay mean "
+                 << (stats.completed > 0 ? double(stats.queueDelay) / stats.completed : 0.0) << " max " << stats.maxQueueDelay
+                 << ", throughput " << setprecision(4) << (m_time > 0 ? double(stats.completed) / m_time : 0.0) << " per time step" << endl;
+          }
+        }
+
+        if(m_config.printStats) {
+          cout << "Simulation: time steps " << m_time << ", simulated " << m_simulatedSteps << ", events " << m_events << endl;
+        }
+
+        if(Profiler::enabled) {
+          m_profiler.printReport(cout);
+        }
+
+        if(m_config.memReport) {
+          m_memory->printReport(allocatorName(m_config.memory.allocator));
+        }
+      }
+
+      long time() const {return m_time;}
+
+      const Profiler& profiler() const {return m_profiler;}
+
+      // The processes alive now, indexed as in StateChange::p, and the results of every one that has arrived
+      const ProcessTable& processTable() const {return m_procTable;}
+
+      // Called with every state change, in the order they were made, at the end of the time step that made them.
+      // The slot of a process that is done is only reused after its callbacks have been made.
+      // Lets a program running simulations in process follow them without a trace sink, e.g. to stop a run
+      // once a process completes
+      typedef function<void(const long& time, const StateChange& change)> TransitionCallback;
+      void onTransition(const TransitionCallback& callback) {m_onTransition.push_back(callback);}
+
+      // Has lanes follow the run, see ReplicaLanes. Only before the first time step, and not with the paged model,
+      // whose page faults aren't mirrored
+      void runInStep(ReplicaLanes& lanes) {m_lanes = &lanes;}
+
+      // Adds a process that isn't in the workload, see ProcessManagement::addArrival
+      void addArrival(const Process& proc, const vector<IOEvent>& ioEvents) {m_processMgmt.addArrival(proc, ioEvents);}
+
+      // Writes the whole state of the run, as it is between two time steps, to fname, see snapshot.h. The trace
+      // isn't part of it. Only a run with inline IO that isn't reading a feed can be saved. Prints why and returns
+      // false if it can't be
+      bool saveSnapshot(const string& fname) const
+      {
+        if(m_ioModule.mode() != inlineIO) {
+          cerr << "snapshots can only be taken with inline IO" << endl;
+          return false;
+        }
+        if(m_processMgmt.following()) {
+          cerr << "a run reading processes as they come can't be saved" << endl;
+          return false;
+        }
+
+        SnapshotWriter out;
+        out.putUnsigned(snapshotVersion);
+        vector<long> fixed = layout();
+        for(size_t i = 0; i < fixed.size(); i++) {
+          out.put(fixed[i]);
+        }
+
+        out.put(m_time);
+        out.put(m_simulatedSteps);
+        out.put(m_events);
+        for(int c = 0; c < m_config.cpuCount; c++) {
+          out.putUnsigned(m_cpus[c].runningProcess == noProcess ? 0 : m_cpus[c].runningProcess + 1);
+          out.put(m_cpus[c].busyTicks);
+          out.put(m_cpus[c].steals);
+          out.put(m_cpus[c].migrations);
+        }
+
+        m_processMgmt.save(out);
+        m_ioModule.save(out);
+        out.putUnsigned(m_interrupts.size());
+        for(InterruptList::const_iterator it = m_interrupts.begin(); it != m_interrupts.end(); ++it) {
+          out.putUnsigned(it->ioEventID);
+          out.putUnsigned(it->procID);
+        }
+        for(int c = 0; c < m_config.cpuCount; c++) {
+          m_schedulers[c].save(out);
+        }
+        m_memory->save(out);
+        out.putUnsigned(m_metrics != nullptr);
+        if(m_metrics != nullptr) {
+          m_metrics->save(out);
+        }
+
+        if(!out.writeFile(fname)) {
+          cerr << "unable to write snapshot \"" << fname << "\"" << endl;
+          return false;
+        }
+        return true;
+      }
+
+      // Carries on from a snapshot instead of time step 0, on a simulator that hasn't run yet. The workload, the
+      // policy, the number of processors, the MLFQ levels, the memory configuration and the number of devices have
+      // to be the ones it was saved with, the rest, e.g. the quanta, the boost period or a device's depth, may
+      // differ so runs can branch off one warm up.
+      // A run that collects metrics needs a snapshot that has them. Prints why and returns false if it can't
+      bool restoreSnapshot(const string& fname)
+      {
+        SnapshotReader in;
+        if(!in.readFile(fname)) {
+          cerr << "\"" << fname << "\" is not a snapshot" << endl;
+          return false;
+        }
+        if(!in.check(in.getUnsigned() == snapshotVersion)) {
+          cerr << "\"" << fname << "\" is a snapshot from another version" << endl;
+          return false;
+        }
+        vector<long> fixed = layout();
+        for(size_t i = 0; i < fixed.size(); i++) {
+          if(in.get() != fixed[i] && in.good()) {
+            cerr << "\"" << fname << "\" was saved with another policy, processor count, number of levels, memory configuration or number of devices" << endl;
+            return false;
+          }
+        }
+
+        long time = in.get();
+        m_simulatedSteps = in.get();
+        m_events = in.get();
+        for(int c = 0; c < m_config.cpuCount; c++) {
+          m_cpus[c].runningProcess = uint32_t(in.getUnsigned()) - 1; // 0, no process, comes back as noProcess
+          m_cpus[c].busyTicks = in.get();
+          m_cpus[c].steals = in.get();
+          m_cpus[c].migrations = in.get();
+        }
+
+        if(!m_processMgmt.load(in)) {
+          cerr << "\"" << fname << (in.good() ? "\" wasn't saved from this workload" : "\" is damaged") << endl;
+          return false;
+        }
+        // levels index the run queues, a process not yet admitted has the level every process starts with
+        int levels = max<long>(layout()[2], 1);
+        for(uint32_t p = 0; p < m_procTable.size(); p++) {
+          int level = m_procTable.level[p];
+          in.check(m_procTable.state[p] == newArrival ? level == 3 : level >= 1 && level <= levels);
+        }
+        for(int c = 0; c < m_config.cpuCount; c++) {
+          in.check(m_cpus[c].runningProcess == noProcess || m_cpus[c].runningProcess < m_procTable.size());
+        }
+        if(!in.good()) {
+          cerr << "\"" << fname << "\" is damaged" << endl;
+          return false;
+        }
+        m_index.rebuild();
+        m_ioModule.load(in, m_procTable.size(), time);
+        for(uint64_t n = in.getCount(); n > 0; n--) {
+          unsigned int ioEventID = in.getUnsigned();
+          m_interrupts.push_back(IOInterrupt(ioEventID, in.getIndex(m_procTable.size())));
+        }
+        for(int c = 0; c < m_config.cpuCount; c++) {
+          m_schedulers[c].load(in, time);
+        }
+        m_memory->load(in, m_procTable.size());
+        bool hasMetrics = in.getUnsigned() != 0;
+        if(m_metrics != nullptr && in.good()) {
+          if(!hasMetrics) {
+            cerr << "\"" << fname << "\" was saved from a run that didn't collect metrics" << endl;
+            return false;
+          }
+          m_metrics->load(in);
+        }
+        if(!in.good() || (hasMetrics == (m_metrics != nullptr) && !in.atEnd())) {
+          cerr << "\"" << fname << "\" is damaged" << endl;
+          return false;
+        }
+
+        m_time = time;
+        m_runningCount = 0;
+        m_queuedCount = 0;
+        for(int c = 0; c < m_config.cpuCount; c++) {
+          m_runningCount += m_cpus[c].runningProcess != noProcess;
+          m_queuedCount += m_schedulers[c].size();
+        }
+        return true;
+      }
+
+      // Simulate the next time step, and in event mode skip over the ones before it where nothing can happen.
+      // Meant to be called until finished(), after that the processors just idle. Returns false if the workload
+      // can't be run
+      bool step()
+      {
+        ProfileScope stepScope(m_profiler, stepPhase);
+        if(m_config.eventDriven) { // Skip the time steps on which nothing but a continueRun or a noAct could happen
+          ProfileScope skipScope(m_profiler, skipPhase);
+          long nextEvent = LONG_MAX; // The next time step that needs to be simulated in full
+          bool idleWork = !m_interrupts.empty() || m_queuedCount != 0 || m_index.nextArrival() != noProcess; // An idle processor has something to do
+          for(int c = 0; c < m_config.cpuCount && nextEvent > m_time + 1; c++) {
+            uint32_t runningProcess = m_cpus[c].runningProcess;
+            if(runningProcess != noProcess) { // Run up to the tick where the process blocks, finishes or uses up its quantum
+              long runFor = min(m_procTable.reqProcessorTime[runningProcess] - m_procTable.processorTime[runningProcess],
+                                m_schedulers[c].quantum(runningProcess) - m_procTable.timeUsedThisQuantum[runningProcess]);
+              if(m_procTable.hasIOEvent(runningProcess) && m_procTable.nextIOEvent(runningProcess).time > m_procTable.processorTime[runningProcess]) {
+                runFor = min(runFor, m_procTable.nextIOEvent(runningProcess).time - m_procTable.processorTime[runningProcess]);
+              }
+              if(m_paging != nullptr) { // Any time step can fault
+                runFor = 1;
+              }
+              nextEvent = min(nextEvent, m_time + runFor);
+            } else if(idleWork) {
+              nextEvent = m_time + 1;
+            } else { // Idle, wait for an arrival or an IO completion
+              long nextArrival = m_processMgmt.nextArrivalTime();
+              long nextCompletion = m_ioModule.nextCompletionTime();
+              if(nextArrival != -1) {
+                nextEvent = min(nextEvent, nextArrival);
+              }
+              if(nextCompletion != -1) {
+                nextEvent = min(nextEvent, nextCompletion);
+              }
+            }
+          }
+          if(nextEvent > m_time + 1 && nextEvent != LONG_MAX) {
+            long skip = nextEvent - m_time - 1;
+            for(int c = 0; c < m_config.cpuCount; c++) {
+              uint32_t runningProcess = m_cpus[c].runningProcess;
+              if(runningProcess != noProcess) {
+                m_procTable.processorTime[runningProcess] += skip;
+                m_procTable.timeUsedThisQuantum[runningProcess] += skip;
+                m_cpus[c].busyTicks += skip;
+              }
+            }
+            m_time += skip;
+          }
+        }
+
+        //Update our current time step
+        ++m_time;
+        m_memory->account(m_time); // memory looked the way it does now since the last time step that was simulated
+        if(m_lanes != nullptr) {
+          m_lanes->account(m_time);
+        }
+
+        //let the scheduling policy do anything it does on a timer, e.g. an MLFQ priority boost
+        {
+          ProfileScope scope(m_profiler, updatePhase);
+          for(int c = 0; c < m_config.cpuCount; c++) {
+            m_schedulers[c].update(m_time);
+          }
+        }
+
+        //let new processes in if there are any
+        {
+          ProfileScope scope(m_profiler, activatePhase);
+          const vector<uint32_t>& activated = m_processMgmt.activateProcesses(m_time);
+          for(size_t i = 0; i < activated.size(); ++i) {
+            uint32_t p = activated[i];
+            if(!m_memory->canHold(m_procTable.memoryRequired[p])) {
+              cerr << "process " << m_procTable.id[p] << " needs " << m_procTable.memoryRequired[p] << " bytes, more than the "
+                   << allocatorName(m_config.memory.allocator) << " allocator can ever give it" << endl;
+              return false;
+            }
+            for(const IOEvent* ioEvent = m_procTable.ioNext[p]; ioEvent != m_procTable.ioEnd[p]; ++ioEvent) {
+              if(ioEvent->device >= m_ioModule.deviceCount()) {
+                cerr << "process " << m_procTable.id[p] << " makes IO requests to device " << ioEvent->device
+                     << ", which isn't configured, see --device" << endl;
+                return false;
+              }
+            }
+            if(m_lanes != nullptr) {
+              m_lanes->activated(p, m_procTable.result[p]);
+            }
+            m_index.activated(p);
+          }
+        }
+
+        //update the status for any active IO requests
+        {
+          ProfileScope scope(m_profiler, ioPhase);
+          m_ioModule.ioProcessing(m_time);
+        }
+
+        //If the processor is tied up running a process, then continue running it until it is done or blocks
+        //   note: be sure to check for things that should happen as the process continues to run (io, completion...)
+        //If the processor is free then you can choose the appropriate action to take, the choices (in order of precedence) are:
+        // - admit a new process if one is ready (i.e., take a 'newArrival' process and put them in the 'ready' state)
+        // - address an interrupt if there are any pending (i.e., update the state of a blocked process whose IO operation is complete)
+        // - start processing a ready process if there are any ready
+        //Each processor takes its turn in order, so a lower numbered processor gets first pick
+
+        for(int c = 0; c < m_config.cpuCount; c++) {
+          uint32_t& runningProcess = m_cpus[c].runningProcess;
+          Scheduler& scheduler = m_schedulers[c];
+          stepActionEnum& stepAction = m_steps[c].action;
+          uint32_t& stepProcess = m_steps[c].process; // The process the action is about, for the trace
+
+          //init the stepAction, update below
+          stepAction = noAct;
+          stepProcess = noProcess;
+
+          if(runningProcess != noProcess)  { // Is there a process currently running? ---Yes
+            ProfileScope scope(m_profiler, runPhase);
+            long quantum = scheduler.quantum(runningProcess);
+            long swapTime = m_paging == nullptr ? 0 : m_paging->reference(runningProcess, m_procTable.id[runningProcess],
+                m_procTable.processorTime[runningProcess] + 1, m_procTable.level[runningProcess], m_time);
+            if(swapTime == 0) { // The time step isn't lost to a page fault
+              m_procTable.processorTime[runningProcess]++; // Update processor Time
+              m_procTable.timeUsedThisQuantum[runningProcess]++;
+              m_cpus[c].busyTicks++;
+            }
+            stepProcess = runningProcess;
+            if(swapTime > 0) { // Is the page it touches swapped out? ---Yes, block until the swap device has brought it in
+              m_ioModule.submitIORequest(m_time, IOEvent(0, int(swapTime), pageFaultEventID, m_paging->swapDevice()), runningProcess);
+              m_index.setState(runningProcess, blocked);
+              stepAction = ioRequest;
+            } else if(m_procTable.hasIOEvent(runningProcess) && m_procTable.nextIOEvent(runningProcess).time == m_procTable.processorTime[runningProcess]) {  // Does the running process have an I/O Event? ---Yes
+              m_ioModule.submitIORequest(m_time, m_procTable.nextIOEvent(runningProcess), runningProcess);  // I/O Request
+              m_procTable.ioNext[runningProcess]++;
+              m_index.setState(runningProcess, blocked); // Block Process
+              stepAction = ioRequest;
+            } else if(m_procTable.processorTime[runningProcess] >= m_procTable.reqProcessorTime[runningProcess]) { // ---No--- Has the running process run long enough? ---Yes
+              m_index.setState(runningProcess, done);
+              m_procTable.results[m_procTable.result[runningProcess]].doneTime = m_time;
+              if(m_paging != nullptr) {
+                m_paging->processDone(runningProcess);
+              }
+              stepAction = complete;
+            } else if(m_procTable.timeUsedThisQuantum[runningProcess] >= quantum) { // ---No--- Has the running process run long enough in the level but not done? ---Yes
+              scheduler.quantumExpired(runningProcess); // e.g. drop down a level
+              m_index.setState(runningProcess, ready);
+              scheduler.enqueue(runningProcess);
+              stepAction = endLevel;
+              m_procTable.timeUsedThisQuantum[runningProcess] = 0;
+              runningProcess = noProcess; // If end of level, keep memory allocated
+            } else{ //--- No
+              stepAction = continueRun;
+            }
+            if(stepAction == ioRequest || stepAction == complete) { // If process is blocked or done running completely then deallocate memory
+              if(!release(runningProcess, false)) { // Error, memory partition not found
+                cout << "Error, memory partition not found" << endl;
+              }
+              runningProcess = noProcess;
+            }
+          } else  { // ---No process running
+            uint32_t arrival = m_index.nextArrival();
+            if(arrival != noProcess)  { // Are there any new Arrivals? ---Yes
+              ProfileScope scope(m_profiler, admitPhase);
+              stepProcess = arrival;
+              if(allocate(arrival))  { // Is there memory available? ---Yes, allocate it
+                scheduler.admit(arrival); // add to the ready queues, on the top level
+                m_procTable.cpu[arrival] = c;
+                m_index.setState(arrival, ready);
+                stepAction = admitNewProc;
+              } else { // Is there memory available? ---No
+                scheduler.admit(arrival); // add to the ready queues, on the top level
+                m_procTable.cpu[arrival] = c;
+                m_index.setState(arrival, memBlocked);
+                stepAction = admitNewProc;
+              }
+            } // If there is a new arrival, then we skip the next statements
+
+            if(!m_interrupts.empty() && stepAction != admitNewProc) { // ---No--- Are there any pending interrupts? ---Yes
+              ProfileScope scope(m_profiler, interruptPhase);
+              IOInterrupt interrupt = m_interrupts.front();
+              m_interrupts.pop_front(); //Removes interrupt
+              m_ioModule.handled(interrupt);
+
+              uint32_t unblocked = m_index.blockedProcess(interrupt.procID); // Looks up the process the interrupt is for
+              if (unblocked != noProcess) {
+                if(allocate(unblocked)) { // Is there memory available? ---Yes
+                  m_index.setState(unblocked, ready);
+                } else { // No
+                  m_index.setState(unblocked, memBlocked);
+                }
+                scheduler.enqueue(unblocked); // Regardless of Memory availability, put process back into queue, on this processor
+                stepAction = handleInterrupt;
+                stepProcess = unblocked;
+              }
+            } else if(stepAction != admitNewProc) { // ---No--- Are there any processes in the ready Queues? ---Yes
+              ProfileScope scope(m_profiler, dispatchPhase);
+              if(runningProcess == noProcess) {
+                runningProcess = scheduler.pickNext();
+                if (runningProcess == noProcess) { // Nothing queued here, steal from the processor with the most queued
+                  int busiest = -1;
+                  for(int other = 0; other < m_config.cpuCount; other++) {
+                    if(!m_schedulers[other].empty() && (busiest == -1 || m_schedulers[other].size() > m_schedulers[busiest].size())) {
+                      busiest = other;
+                    }
+                  }
+                  if(busiest != -1) {
+                    runningProcess = m_schedulers[busiest].steal();
+                    m_cpus[c].steals++;
+                  }
+                }
+                if (runningProcess != noProcess) {
+                  if (m_procTable.state[runningProcess] == memBlocked) { // Is memory allocated to this process? ---No
+                    // Would it fit if nothing but the running processes held memory? ---No, leave the ready ones be and wait
+                    bool fits = m_memory->fitsBeside(m_procTable.memoryRequired[runningProcess], runningProcesses());
+                    if (m_lanes != nullptr) {
+                      m_lanes->checkedFit(runningProcess, m_running, fits);
+                    }
+                    if (!fits) {
+                      scheduler.enqueue(runningProcess);
+                      runningProcess = noProcess;
+                    }
+                    // Is there available memory now? ---No, take it from the lowest priority processes until it fits
+                    while (runningProcess != noProcess && !allocate(runningProcess)) {
+                      uint32_t lowProcess = m_index.lowestPriorityReady(); // find lowest priority process
+                      if (lowProcess == noProcess) { // The rest belongs to running processes, so wait
+                        scheduler.enqueue(runningProcess);
+                        runningProcess = noProcess;
+                        break;
+                      }
+                      m_index.setState(lowProcess, memBlocked); // Deallocate memory
+                      if (!release(lowProcess, true)) { // Error, memory not found
+                        cout << "Error, memory not found" << endl;
+                      }
+                    }
+                  } // ---Yes, Continue
+                }
+                if (runningProcess != noProcess) {
+                  if(m_procTable.cpu[runningProcess] != c) { // Last ran or was admitted somewhere else
+                    m_procTable.cpu[runningProcess] = c;
+                    m_cpus[c].migrations++;
+                  }
+                  m_index.setState(runningProcess, processing);
+                  stepAction = beginRun;
+                  stepProcess = runningProcess;
+                }
+              }
+            }
+          }
+        }
+
+        m_runningCount = 0;
+        m_queuedCount = 0;
+        for(int c = 0; c < m_config.cpuCount; c++) {
+          m_runningCount += m_cpus[c].runningProcess != noProcess;
+          m_queuedCount += m_schedulers[c].size();
+        }
+
+        for(int c = 0; c < m_config.cpuCount; c++) {
+          m_steps[c].running = m_cpus[c].runningProcess;
+          m_events += m_steps[c].action != continueRun && m_steps[c].action != noAct;
+        }
+        m_simulatedSteps++;
+        if(Profiler::enabled) {
+          sampleQueues();
+        }
+        {
+          ProfileScope scope(m_profiler, outputPhase);
+          m_sink.step(m_time, m_steps, m_index.changes(), m_procTable, *m_memory);
+        }
+        if(m_metrics != nullptr) {
+          ProfileScope scope(m_profiler, metricsPhase);
+          m_metrics->record(m_time, m_index.changes(), m_procTable);
+        }
+        const vector<StateChange>& changes = m_index.changes();
+        for(size_t i = 0; i < m_onTransition.size(); i++) {
+          for(size_t n = 0; n < changes.size(); n++) {
+            m_onTransition[i](m_time, changes[n]);
+          }
+        }
+        for(size_t n = 0; n < changes.size(); n++) { // Everything has seen the finished processes, their slots are free
+          if(changes[n].to == done) {
+            m_procTable.release(changes[n].p);
+          }
+        }
+        m_index.clearChanges();
+        if(m_config.sleepDuration > 0) { // Pace the output so it can be watched
+          cout.flush();
+          this_thread::sleep_for(chrono::milliseconds(m_config.sleepDuration));
+        }
+        return true;
+      }
+
+    private:
+      static const uint64_t snapshotVersion = 4;
+
+      // The parts of the configuration a snapshot is bound to, everything else can change when a run is resumed
+      vector<long> layout() const
+      {
+        const SchedConfig& sched = m_config.sched;
+        long levels = sched.policy != mlfqPolicy ? 0 : sched.levels > 0 ? sched.levels : sched.quanta.size();
+        const MemConfig& memory = m_config.memory;
+        bool paged = memory.allocator == pagedAllocator;
+        return {sched.policy, m_config.cpuCount, levels, memory.allocator, memory.totalMemory, memory.partitions, memory.minBlock,
+                long(m_ioModule.deviceCount()), paged ? memory.pageSize : 0, paged ? memory.replacement : 0};
+      }
+
+      // The processes running on any processor, the ones dispatched earlier in this time step included
+      const vector<uint32_t>& runningProcesses()
+      {
+        m_running.clear();
+        for(int c = 0; c < m_config.cpuCount; c++) {
+          if(m_cpus[c].runningProcess != noProcess && m_procTable.state[m_cpus[c].runningProcess] == processing) {
+            m_running.push_back(m_cpus[c].runningProcess);
+          }
+        }
+        return m_running;
+      }
+
+      // Gives p its memory, returns false if there isn't room for it right now. The lanes, if any, try the same
+      bool allocate(const uint32_t& p)
+      {
+        bool got = m_memory->allocate(p, m_procTable.memoryRequired[p]);
+        if(m_lanes != nullptr) {
+          m_lanes->allocated(p, got);
+        }
+        return got;
+      }
+
+      // Takes p's memory back, evicted when another process needs it, returns false if p didn't hold any
+      bool release(const uint32_t& p, const bool& evicted)
+      {
+        bool had = evicted ? m_memory->evict(p) : m_memory->release(p);
+        if(m_lanes != nullptr) {
+          m_lanes->released(p, had, evicted);
+        }
+        return had;
+      }
+
+      // Lengths of the ready processes on each level, the blocked ones and the outstanding IO, for the profile
+      void sampleQueues()
+      {
+        m_profiler.sample(blockedQueue, m_index.blockedCount());
+        m_profiler.sample(ioPendingQueue, m_ioModule.pendingCount());
+        for(int level = 0; level < m_index.levelCount(); level++) {
+          m_profiler.sample(readyQueue, m_index.readyCount(level), level);
+        }
+      }
+
+      SimConfig m_config;
+      TraceSink& m_sink;
+      Metrics* m_metrics;
+      Profiler m_profiler;              // Times the phases of a time step, only in a profiling build, see profile.h
+      vector<TransitionCallback> m_onTransition;
+
+      // the nodes of every container below come from here, and all of it is freed at once with the simulator
+      Arena m_arena;
+
+      // table of processes, processes will appear here when they are created by
+      // the ProcessMgmt object (in other words, automatically at the appropriate time)
+      ProcessTable m_procTable;
+
+      // this will orchestrate process creation in our system, it will add processes to
+      // procTable when they are created and ready to be run/managed
+      ProcessManagement m_processMgmt;
+
+      // this is where interrupts will appear when the ioModule detects that an IO operation is complete
+      InterruptList m_interrupts;
+
+      // this manages io operations and will raise interrupts to signal io completion
+      IOModule m_ioModule;
+
+      ProcessIndex m_index;             // Finds processes by state without walking procTable, e.g. the blocked ones
+      vector<Cpu> m_cpus;
+      vector<uint32_t> m_running;       // Scratch for runningProcesses
+      vector<CpuStep> m_steps;          // What each processor did this time step
+      vector<Scheduler> m_schedulers;   // The ready queues of each processor and the policy that orders them
+
+      unique_ptr<MemoryAllocator> m_memory; // Gives memory to processes, 4 partitions of 256 bytes unless configured otherwise
+      PagedMemory* m_paging;                // m_memory when it is the paged model, which processes run through, otherwise null
+      ReplicaLanes* m_lanes;                // Replicas running in lockstep with this one, see runInStep, usually null
+
+      long m_time;
+      int m_runningCount;               // Processors with a process running
+      long m_queuedCount;               // Processes on any run queue
+      long m_simulatedSteps;            // Time steps simulated in full, the rest were skipped over in event mode
+      long m_events;                    // Actions other than carrying on running or idling
+};
+
+// What a single run does besides simulating the workload from the start to the end
+struct RunOptions
+{
+    RunOptions() : feed(nullptr), saveAt(0), stopAfterSave(false) {}
+
+    ArrivalFeed* feed;      // processes that arrive on top of the workload's as they are read
+    string resumeFrom;      // snapshot to carry on from instead of time step 0
+    string saveTo;          // snapshot to write once the run gets to saveAt, see Simulator::runUntil
+    long saveAt;
+    bool stopAfterSave;     // end the run there, with the trace and metrics so far but no reports
+    string profileFile;     // folded stacks of the profile, for a flame graph, only in a profiling build
+};
+
+template<class Scheduler>
+int runWith(const Workload& workload, const SimConfig& config, TraceSink& sink, Metrics* metrics, const bool& printReports,
+            const RunOptions& options)
+{
+    Simulator<Scheduler> simulator(workload, config, sink, metrics, options.feed);
+    if(!options.resumeFrom.empty() && !simulator.restoreSnapshot(options.resumeFrom))
+    {
+        return 1;
+    }
+    if(!options.saveTo.empty())
+    {
+        if(!simulator.runUntil(options.saveAt) || !simulator.saveSnapshot(options.saveTo))
+        {
+            return 1;
+        }
+        if(options.stopAfterSave)
+        {
+            simulator.finish();
+            return 0;
+        }
+    }
+    int status = simulator.runToCompletion();
+    if(status == 0 && printReports)
+    {
+        simulator.printReports();
+    }
+    if(status == 0 && !options.profileFile.empty() && !simulator.profiler().writeFolded(options.profileFile))
+    {
+        cerr << "unable to write profile \"" << options.profileFile << "\"" << endl;
+        return 1;
+    }
+    return status;
+}
+
+// Runs the workload under the scheduling policy config.sched asks for, and prints the end of run reports to
+// cout if printReports is set. Returns 0, or 1 if the workload can't be run
+inline int runSimulation(const Workload& workload, const SimConfig& config, TraceSink& sink, Metrics* metrics,
+                         const bool& printReports, const RunOptions& options = RunOptions())
+{
+    // each policy gets its own copy of the simulation loop
+    switch(config.sched.policy)
+    {
+        case mlfqPolicy:
+            return runWith<MLFQScheduler>(workload, config, sink, metrics, printReports, options);
+        case roundRobinPolicy:
+            return runWith<RoundRobinScheduler>(workload, config, sink, metrics, printReports, options);
+        case srtfPolicy:
+            return runWith<SRTFScheduler>(workload, config, sink, metrics, printReports, options);
+        case lotteryPolicy:
+            return runWith<LotteryScheduler>(workload, config, sink, metrics, printReports, options);
+        case stridePolicy:
+            return runWith<StrideScheduler>(workload, config, sink, metrics, printReports, options);
+    }
+    return 0;
+}
+
+#endif
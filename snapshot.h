@@ -0,0 +1,164 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include<vector>
+#include<string>
+#include<fstream>
+#include<iterator>
+#include<cstdint>
+using namespace std;
+
+/*
+
+Simulation snapshots, written by Simulator::saveSnapshot between two time steps and read back by
+Simulator::restoreSnapshot so a run can carry on from there, or several runs can branch off one warm up
+
+  char[8]   "SIMSNAPS"
+  then varints, see SnapshotWriter, in this order
+    format version, 4
+    the parts of the configuration a snapshot only fits, see Simulator::saveSnapshot
+    the simulator's clock and processors
+    ProcessManagement and the process table
+    the IO module and the interrupts waiting to be handled
+    each processor's scheduler
+    the memory allocator
+    the metrics, if the run collects them
+
+Every component writes and reads its own part, in the same order, so the format is whatever the code says. A
+snapshot only makes sense to the version of the simulator that wrote it, the version is bumped whenever
+anything changes
+
+*/
+
+const char snapshotMagic[] = "SIMSNAPS";
+
+// Builds a snapshot in memory. Every number is a varint, 7 bits a byte with the top bit set on all but the last,
+// signed numbers are zigzag encoded first so small negative ones stay small
+class SnapshotWriter
+{
+    public:
+      SnapshotWriter() : m_data(snapshotMagic, snapshotMagic + 8) {}
+
+      void putUnsigned(uint64_t v)
+      {
+        while(v >= 0x80)
+        {
+            m_data.push_back(char(v & 0x7F) | char(0x80));
+            v >>= 7;
+        }
+        m_data.push_back(char(v));
+      }
+
+      void put(const int64_t& v) {putUnsigned((uint64_t(v) << 1) ^ uint64_t(v >> 63));}
+
+      void putString(const string& s)
+      {
+        putUnsigned(s.size());
+        m_data.insert(m_data.end(), s.begin(), s.end());
+      }
+
+      // Returns false if the file can't be written
+      bool writeFile(const string& fname) const
+      {
+        ofstream out(fname.c_str(), ios::binary);
+        out.write(m_data.data(), m_data.size());
+        out.close();
+        return !out.fail();
+      }
+
+      size_t size() const {return m_data.size();}
+
+    private:
+      vector<char> m_data;
+};
+
+// Reads back what a SnapshotWriter wrote. Reading past the end or anything out of range makes the reader bad,
+// after which every read returns 0, so a loader can read on and check good() once at the end
+class SnapshotReader
+{
+    public:
+      SnapshotReader() : m_pos(0), m_good(false) {}
+
+      // Returns false if the file can't be read or isn't a snapshot
+      bool readFile(const string& fname)
+      {
+        ifstream in(fname.c_str(), ios::binary);
+        if(!in.good())
+        {
+            return false;
+        }
+        m_data.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        m_good = m_data.size() >= 8 && string(m_data.data(), 8) == snapshotMagic;
+        m_pos = 8;
+        return m_good;
+      }
+
+      uint64_t getUnsigned()
+      {
+        uint64_t v = 0;
+        for(int shift = 0; m_good; shift += 7)
+        {
+            if(m_pos == m_data.size() || shift > 63)
+            {
+                m_good = false;
+                break;
+            }
+            uint8_t byte = m_data[m_pos++];
+            v |= uint64_t(byte & 0x7F) << shift;
+            if((byte & 0x80) == 0)
+            {
+                return v;
+            }
+        }
+        return 0;
+      }
+
+      int64_t get()
+      {
+        uint64_t v = getUnsigned();
+        return int64_t(v >> 1) ^ -int64_t(v & 1);
+      }
+
+      string getString()
+      {
+        uint64_t size = getCount();
+        string s(m_data.begin() + m_pos, m_data.begin() + m_pos + size);
+        m_pos += size;
+        return s;
+      }
+
+      // The number of things that follow, each takes at least a byte so a damaged count can't ask for more
+      // memory than the snapshot could fill
+      uint64_t getCount()
+      {
+        uint64_t count = getUnsigned();
+        return check(count <= m_data.size() - m_pos) ? count : 0;
+      }
+
+      // An index below limit, e.g. into the process table
+      uint64_t getIndex(const uint64_t& limit)
+      {
+        uint64_t index = getUnsigned();
+        return check(index < limit) ? index : 0;
+      }
+
+      // Makes the reader bad unless ok, for a loader that finds something that doesn't fit. Returns ok
+      bool check(const bool& ok)
+      {
+        if(!ok)
+        {
+            m_good = false;
+        }
+        return m_good;
+      }
+
+      bool good() const {return m_good;}
+      bool atEnd() const {return m_pos == m_data.size();}
+
+    private:
+      vector<char> m_data;
+      size_t m_pos;
+      bool m_good;
+};
+
+#endif
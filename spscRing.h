@@ -0,0 +1,69 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include<vector>
+#include<atomic>
+#include<cstddef>
+using namespace std;
+
+// A bounded queue between exactly one producer thread and one consumer thread, without locks. The
+// producer only writes m_tail and the consumer only writes m_head, each keeps a cached copy of the other
+// index so it only has to read the shared one when the ring looks full or empty. The indices are padded
+// onto cache lines of their own so the two threads don't keep taking the line from each other
+template<class T>
+class SpscRing
+{
+    public:
+      // capacity has to be a power of two
+      explicit SpscRing(size_t capacity) : m_slots(capacity), m_mask(capacity - 1), m_padHead(), m_head(0), m_tailCache(0), m_padTail(), m_tail(0), m_headCache(0), m_padEnd() {}
+
+      SpscRing(const SpscRing&) = delete;
+      SpscRing& operator=(const SpscRing&) = delete;
+
+      // Producer side, returns false if the ring is full
+      bool push(const T& item)
+      {
+        size_t tail = m_tail.load(memory_order_relaxed);
+        if(tail - m_headCache == m_slots.size()) {
+          m_headCache = m_head.load(memory_order_acquire);
+          if(tail - m_headCache == m_slots.size()) {
+            return false;
+          }
+        }
+        m_slots[tail & m_mask] = item;
+        m_tail.store(tail + 1, memory_order_release);
+        return true;
+      }
+
+      // Consumer side, returns false if the ring is empty
+      bool pop(T& item)
+      {
+        size_t head = m_head.load(memory_order_relaxed);
+        if(head == m_tailCache) {
+          m_tailCache = m_tail.load(memory_order_acquire);
+          if(head == m_tailCache) {
+            return false;
+          }
+        }
+        item = m_slots[head & m_mask];
+        m_head.store(head + 1, memory_order_release);
+        return true;
+      }
+
+    private:
+      static const size_t cacheLine = 64;
+
+      vector<T> m_slots;
+      const size_t m_mask;
+
+      char m_padHead[cacheLine];
+      atomic<size_t> m_head;    // Next slot to pop, written by the consumer
+      size_t m_tailCache;       // The consumer's last look at m_tail
+
+      char m_padTail[cacheLine];
+      atomic<size_t> m_tail;    // Next slot to push, written by the producer
+      size_t m_headCache;       // The producer's last look at m_head
+      char m_padEnd[cacheLine];
+};
+
+#endif
@@ -0,0 +1,216 @@
+#include "sweep.h"
+
+#include <atomic>
+#include <iomanip>
+
+bool parseSweepAxis(const string& arg, SweepAxis& axis)
+{
+    size_t equals = arg.find('=');
+    if(equals == string::npos)
+    {
+        return false;
+    }
+
+    axis.name = arg.substr(0, equals);
+    axis.values.clear();
+    size_t start = equals + 1;
+    while(start <= arg.size())
+    {
+        size_t end = arg.find('/', start);
+        if(end == string::npos)
+        {
+            end = arg.size();
+        }
+        if(end > start)
+        {
+            axis.values.push_back(arg.substr(start, end - start));
+        }
+        start = end + 1;
+    }
+
+    // check the name against a default config, the values are checked once they are applied
+    SimConfig config;
+    return !axis.values.empty() && applySweepValue(axis.name, axis.values[0], config);
+}
+
+// The whole of value has to be a number
+static bool parseNumber(const string& value, long& number)
+{
+    char* end;
+    number = strtol(value.c_str(), &end, 10);
+    return !value.empty() && *end == '\0';
+}
+
+bool applySweepValue(const string& name, const string& value, SimConfig& config)
+{
+    long number = 0;
+    if(name == "policy")
+    {
+        return parsePolicy(value, config.sched.policy);
+    }
+    else if(name == "quanta")
+    {
+        return parseQuanta(value, config.sched.quanta);
+    }
+    else if(name == "memory")
+    {
+        return parseAllocator(value, config.memory.allocator);
+    }
+    else if(!parseNumber(value, number))
+    {
+        return false;
+    }
+    else if(name == "levels")
+    {
+        config.sched.levels = number;
+    }
+    else if(name == "boost")
+    {
+        config.sched.boostPeriod = number;
+    }
+    else if(name == "tickets")
+    {
+        config.sched.tickets = number;
+    }
+    else if(name == "cpus")
+    {
+        config.cpuCount = number;
+    }
+    else if(name == "mem-size")
+    {
+        config.memory.totalMemory = number;
+    }
+    else if(name == "partitions")
+    {
+        config.memory.partitions = number;
+    }
+    else if(name == "min-block")
+    {
+        config.memory.minBlock = number;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// What is kept of a run for the table
+struct SweepResult
+{
+    SweepResult() : status(0), wallMs(0) {}
+
+    int status;
+    Metrics metrics;
+    double wallMs;
+};
+
+int runSweep(const Workload& workload, const SimConfig& base, const vector<SweepAxis>& axes, const int& threads, ostream& out,
+             const string& resumeFrom)
+{
+    // the grid, the first axis changes slowest
+    size_t points = 1;
+    for(size_t a = 0; a < axes.size(); a++)
+    {
+        points *= axes[a].values.size();
+    }
+
+    vector<SimConfig> configs(points, base);
+    vector<vector<size_t> > choices(points, vector<size_t>(axes.size()));
+    for(size_t i = 0; i < points; i++)
+    {
+        size_t rest = i;
+        for(size_t a = axes.size(); a-- > 0;)
+        {
+            choices[i][a] = rest % axes[a].values.size();
+            rest /= axes[a].values.size();
+            applySweepValue(axes[a].name, axes[a].values[choices[i][a]], configs[i]);
+        }
+
+        // the runs share cout, so they don't pace or report
+        configs[i].sleepDuration = 0;
+        configs[i].memReport = false;
+        configs[i].printStats = false;
+
+        string problem = checkConfig(configs[i]);
+        if(!problem.empty())
+        {
+            cerr << "sweep point";
+            for(size_t a = 0; a < axes.size(); a++)
+            {
+                cerr << ' ' << axes[a].name << '=' << axes[a].values[choices[i][a]];
+            }
+            cerr << ": " << problem << endl;
+            return 1;
+        }
+    }
+
+    // every worker takes the next run nobody has taken yet until there are none left, the results go where
+    // the run is in the grid so nothing else is shared between them
+    vector<SweepResult> results(points);
+    RunOptions options;
+    options.resumeFrom = resumeFrom;
+    atomic<size_t> next(0);
+    auto worker = [&]()
+    {
+        for(size_t i = next++; i < points; i = next++)
+        {
+            chrono::steady_clock::time_point start = chrono::steady_clock::now();
+            SummarySink sink;
+            results[i].status = runSimulation(workload, configs[i], sink, &results[i].metrics, false, options);
+            results[i].wallMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        }
+    };
+
+    vector<thread> pool;
+    for(size_t t = 1; t < min(points, size_t(max(threads, 1))); t++)
+    {
+        pool.push_back(thread(worker));
+    }
+    worker();
+    for(size_t t = 0; t < pool.size(); t++)
+    {
+        pool[t].join();
+    }
+
+    for(size_t a = 0; a < axes.size(); a++)
+    {
+        out << axes[a].name << ',';
+    }
+    out << "status,timeSteps,turnaroundMean,turnaroundP95,responseMean,responseP95,readyWaitMean,cpuUtilization,wallMs" << endl;
+
+    int status = 0;
+    for(size_t i = 0; i < points; i++)
+    {
+        for(size_t a = 0; a < axes.size(); a++)
+        {
+            // quanta lists have commas of their own
+            const string& value = axes[a].values[choices[i][a]];
+            if(value.find(',') != string::npos)
+            {
+                out << '"' << value << "\",";
+            }
+            else
+            {
+                out << value << ',';
+            }
+        }
+
+        const SweepResult& result = results[i];
+        if(result.status != 0)
+        {
+            out << "failed,,,,,,,," << endl;
+            status = 1;
+            continue;
+        }
+
+        vector<pair<string, MetricSummary> > summaries = result.metrics.summaries();
+        const MetricSummary& turnaround = summaries[0].second;
+        const MetricSummary& response = summaries[1].second;
+        const MetricSummary& readyWait = summaries[2].second;
+        out << "ok," << result.metrics.time() << ',' << fixed << setprecision(4) << turnaround.mean << ',' << turnaround.p95 << ','
+            << response.mean << ',' << response.p95 << ',' << readyWait.mean << ',' << result.metrics.cpuUtilization() << ','
+            << setprecision(3) << result.wallMs << endl;
+    }
+    return status;
+}
@@ -0,0 +1,35 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include<vector>
+#include<string>
+#include<iostream>
+using namespace std;
+
+#include "simulator.h"
+
+// One parameter of a sweep and the values it takes, given on the command line as name=v1/v2/...
+// The names are the long options they stand for: policy, levels, quanta, boost, tickets, cpus, memory,
+// mem-size, partitions and min-block
+struct SweepAxis
+{
+    string name;
+    vector<string> values;
+};
+
+// Parses name=v1/v2/..., returns false if the name isn't a parameter or there are no values
+bool parseSweepAxis(const string& arg, SweepAxis& axis);
+
+// Sets the parameter name of config to value, returns false if value doesn't parse
+bool applySweepValue(const string& name, const string& value, SimConfig& config);
+
+// Runs the workload once for every combination of the axes values, on top of base, spread over threads
+// threads. Every run gets its own Simulator and only reads the workload, per tick output is dropped and
+// the end of run metrics of all runs are written to out as one csv table, in grid order whatever order the
+// runs finished in. With resumeFrom every run carries on from that snapshot, which has to have been saved with
+// metrics, so what-if runs can share one warm up. Returns 0, or 1 if a combination isn't a valid configuration
+// or a run failed
+int runSweep(const Workload& workload, const SimConfig& base, const vector<SweepAxis>& axes, const int& threads, ostream& out,
+             const string& resumeFrom = "");
+
+#endif
@@ -0,0 +1,252 @@
+// Runs the simulator over a fixed matrix of generated workloads and appends one row per run to a CSV file,
+// so throughput can be tracked from commit to commit. Each run is timed on the wall clock and its peak
+// resident set size is taken from the kernel; time steps and events come from the simulator's --stats line
+//
+// usage: bench program workloadGen results.csv [label]
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+using namespace std;
+
+struct Workload
+{
+    string name;
+    long jobs;
+    string genArgs;     // everything but the job count
+    string simArgs;     // added to every run of this workload
+};
+
+struct Run
+{
+    string mode;        // tick or event
+    int cpus;
+    string output;      // summary or binary
+};
+
+struct Result
+{
+    bool ok;
+    double wallSeconds;
+    long peakRssKb;
+    long timeSteps;
+    long simulatedSteps;
+    long events;
+};
+
+static vector<char*> argvOf(vector<string>& args)
+{
+    vector<char*> argv;
+    for(size_t i = 0; i < args.size(); i++)
+    {
+        argv.push_back(&args[i][0]);
+    }
+    argv.push_back(nullptr);
+    return argv;
+}
+
+static vector<string> split(const string& line)
+{
+    vector<string> words;
+    istringstream in(line);
+    string word;
+    while(in >> word)
+    {
+        words.push_back(word);
+    }
+    return words;
+}
+
+// Runs args with stdout going to outFd, returns the exit status or -1, and the resources the child used
+static int runChild(vector<string> args, const int& outFd, rusage& usage)
+{
+    vector<char*> argv = argvOf(args);
+    pid_t pid = fork();
+    if(pid == 0)
+    {
+        dup2(outFd, STDOUT_FILENO);
+        execv(argv[0], argv.data());
+        perror(argv[0]);
+        _exit(127);
+    }
+    if(pid < 0)
+    {
+        return -1;
+    }
+
+    int status;
+    if(wait4(pid, &status, 0, &usage) != pid || !WIFEXITED(status))
+    {
+        return -1;
+    }
+    return WEXITSTATUS(status);
+}
+
+static bool generate(const string& generator, const Workload& workload, const string& file)
+{
+    int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+    {
+        return false;
+    }
+    vector<string> args = split(workload.genArgs);
+    args.insert(args.begin(), generator);
+    args.push_back("--jobs");
+    args.push_back(to_string(workload.jobs));
+
+    rusage usage;
+    int status = runChild(args, fd, usage);
+    close(fd);
+    return status == 0;
+}
+
+static Result simulate(const string& program, const Workload& workload, const Run& run, const string& file,
+                       const string& traceFile)
+{
+    Result result = {false, 0, 0, 0, 0, 0};
+
+    vector<string> args = split(workload.simArgs);
+    args.insert(args.begin(), program);
+    args.push_back("-s");
+    args.push_back("1");
+    args.push_back("-c");
+    args.push_back(to_string(run.cpus));
+    args.push_back("-o");
+    args.push_back(run.output);
+    args.push_back("--trace-file");
+    args.push_back(traceFile);
+    args.push_back("--stats");
+    if(run.mode == "event")
+    {
+        args.push_back("-e");
+    }
+    args.push_back(file);
+
+    // the run's output goes to a file and is read back for the stats line, a pipe would need a reader thread
+    string outFile = file + ".out";
+    int fd = open(outFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+    {
+        return result;
+    }
+
+    rusage usage;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    int status = runChild(args, fd, usage);
+    result.wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    close(fd);
+    result.peakRssKb = usage.ru_maxrss;
+
+    ifstream out(outFile.c_str());
+    string line;
+    while(getline(out, line))
+    {
+        if(sscanf(line.c_str(), "Simulation: time steps %ld, simulated %ld, events %ld",
+                  &result.timeSteps, &result.simulatedSteps, &result.events) == 3)
+        {
+            result.ok = status == 0;
+        }
+    }
+    remove(outFile.c_str());
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 4 || argc > 5)
+    {
+        cerr << "usage: " << argv[0] << " program workloadGen results.csv [label]" << endl;
+        return 1;
+    }
+    string program(argv[1]);
+    string generator(argv[2]);
+    string resultsFile(argv[3]);
+    string label(argc > 4 ? argv[4] : "unlabelled");
+
+    const Workload workloads[] = {
+        {"poisson", 1000, "--seed 1 --arrivals poisson --interarrival 20", ""},
+        {"bursty", 1000, "--seed 2 --arrivals bursty --interarrival 20 --burst 16", ""},
+        {"poisson", 20000, "--seed 3 --arrivals poisson --interarrival 150", ""},
+        {"best-fit", 20000, "--seed 4 --arrivals poisson --interarrival 150 --mem uniform:16:512", "-m best-fit"},
+    };
+    const Run runs[] = {
+        {"tick", 1, "summary"},
+        {"event", 1, "summary"},
+        {"event", 1, "binary"},
+        {"tick", 4, "summary"},
+        {"event", 4, "summary"},
+    };
+
+    char dir[] = "/tmp/benchXXXXXX";
+    if(mkdtemp(dir) == nullptr)
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    bool newFile = !ifstream(resultsFile.c_str()).good();
+    ofstream results(resultsFile.c_str(), ios::app);
+    if(!results.good())
+    {
+        cerr << "unable to open \"" << resultsFile << "\"" << endl;
+        return 1;
+    }
+    if(newFile)
+    {
+        results << "label,workload,jobs,mode,cpus,output,wall_s,time_steps,simulated_steps,events,steps_per_s,events_per_s,peak_rss_kb" << endl;
+    }
+
+    cout << left << setw(10) << "workload" << setw(7) << "jobs" << setw(7) << "mode" << setw(5) << "cpus" << setw(9) << "output"
+         << right << setw(9) << "wall s" << setw(12) << "steps" << setw(14) << "steps/s" << setw(14) << "events/s"
+         << setw(11) << "rss KB" << endl;
+
+    int failures = 0;
+    for(size_t w = 0; w < sizeof(workloads) / sizeof(workloads[0]); w++)
+    {
+        const Workload& workload = workloads[w];
+        string file = string(dir) + "/workload" + to_string(w) + ".txt";
+        if(!generate(generator, workload, file))
+        {
+            cerr << "unable to generate workload " << workload.name << endl;
+            failures++;
+            continue;
+        }
+
+        for(size_t r = 0; r < sizeof(runs) / sizeof(runs[0]); r++)
+        {
+            const Run& run = runs[r];
+            Result result = simulate(program, workload, run, file, string(dir) + "/trace.bin");
+            if(!result.ok)
+            {
+                cerr << "run of " << workload.name << " " << workload.jobs << " " << run.mode << " failed" << endl;
+                failures++;
+                continue;
+            }
+
+            double wall = max(result.wallSeconds, 1e-9);
+            results << label << ',' << workload.name << ',' << workload.jobs << ',' << run.mode << ',' << run.cpus << ','
+                    << run.output << ',' << fixed << setprecision(6) << result.wallSeconds << ',' << result.timeSteps << ','
+                    << result.simulatedSteps << ',' << result.events << ',' << setprecision(0) << result.timeSteps / wall << ','
+                    << result.events / wall << ',' << result.peakRssKb << endl;
+            cout << left << setw(10) << workload.name << setw(7) << workload.jobs << setw(7) << run.mode << setw(5) << run.cpus
+                 << setw(9) << run.output << right << fixed << setprecision(3) << setw(9) << result.wallSeconds
+                 << setw(12) << result.timeSteps << setprecision(0) << setw(14) << result.timeSteps / wall
+                 << setw(14) << result.events / wall << setw(11) << result.peakRssKb << endl;
+        }
+        remove(file.c_str());
+    }
+    remove((string(dir) + "/trace.bin").c_str());
+    rmdir(dir);
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+// Rebuilds the per time step lines of a run from the delta trace written by "program -o delta". Only the
+// processor actions and process states are kept in the trace, so the lines stop after the process states
+//
+// usage: traceReader file [from [to]]
+
+#include "trace.h"
+
+#include <cstdlib>
+#include <climits>
+#include <map>
+
+// What the trace says happened on one time step
+struct TickEvents
+{
+    vector<stepActionEnum> actions;     // continueRun where nothing was logged, fixed up when the tick is printed
+    vector<uint32_t> processes;
+};
+
+static void printTick(const long& time, const TickEvents& tick, const vector<uint32_t>& running, const vector<char>& states)
+{
+    cout << setw(5) << time << "\t";
+    for(size_t c = 0; c < tick.actions.size(); c++)
+    {
+        stepActionEnum action = tick.actions[c];
+        if(action == continueRun && running[c] == noProcess) // nothing was logged for an idle processor
+        {
+            action = noAct;
+        }
+        cout << actionLabel(action) << '\t';
+    }
+    for(size_t p = 0; p < states.size(); p++)
+    {
+        cout << states[p] << ' ';
+    }
+    cout << '\n';
+}
+
+// Which process each processor has running once the tick's actions are done
+static void applyTick(const TickEvents& tick, vector<uint32_t>& running)
+{
+    for(size_t c = 0; c < tick.actions.size(); c++)
+    {
+        switch(tick.actions[c])
+        {
+            case beginRun:
+                running[c] = tick.processes[c];
+                break;
+            case ioRequest:
+            case complete:
+            case endLevel:
+                running[c] = noProcess;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+// Prints the ticks from time up to end that fall in [from, to]. Only the first of them can have logged actions,
+// on the rest every processor carries on running or idles
+static void finishTicks(const long& time, const long& end, const long& from, const long& to, TickEvents& tick,
+                        vector<uint32_t>& running, const vector<char>& states)
+{
+    if(time >= from && time <= to)
+    {
+        printTick(time, tick, running, states);
+    }
+    applyTick(tick, running);
+    tick.actions.assign(tick.actions.size(), continueRun);
+
+    for(long quiet = max(time + 1, from), quietEnd = min(end - 1, to); quiet <= quietEnd; quiet++)
+    {
+        printTick(quiet, tick, running, states);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if(argc < 2 || argc > 4)
+    {
+        cerr << "usage: " << argv[0] << " file [from [to]]" << endl;
+        return 1;
+    }
+    long from = argc > 2 ? strtol(argv[2], nullptr, 10) : 1;
+    long to = argc > 3 ? strtol(argv[3], nullptr, 10) : LONG_MAX - 1;
+
+    vector<char> buffer(1 << 20);
+    ifstream in;
+    in.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    in.open(argv[1], ios::binary);
+
+    char header[DeltaSink::headerSize];
+    if(!in.read(header, sizeof(header)) || string(header, 8) != "SIMDELTA" ||
+       getLittleEndian(header + 8, 4) != DeltaSink::version || getLittleEndian(header + 12, 4) != DeltaSink::recordSize)
+    {
+        cerr << "\"" << argv[1] << "\" is not a delta trace" << endl;
+        return 1;
+    }
+    size_t cpuCount = getLittleEndian(header + 16, 4);
+
+    ios::sync_with_stdio(false);
+
+    vector<char> states;                              // the letter of each process, in the order they joined
+    map<uint32_t, size_t> columns;                    // where each process ID's letter is in states
+    vector<uint32_t> running(cpuCount, noProcess);    // as of the start of the tick being read
+    TickEvents tick;
+    tick.actions.assign(cpuCount, continueRun);
+    tick.processes.assign(cpuCount, noProcess);
+    long time = 1; // the tick being read, the ones before it are done
+    bool any = false;
+
+    char record[DeltaSink::recordSize];
+    while(in.read(record, sizeof(record)))
+    {
+        long recordTime = getLittleEndian(record, 8);
+        if(recordTime > to)
+        {
+            finishTicks(time, to + 1, from, to, tick, running, states);
+            return 0;
+        }
+        if(recordTime != time)
+        {
+            finishTicks(time, recordTime, from, to, tick, running, states);
+            time = recordTime;
+        }
+        any = true;
+
+        uint32_t p = getLittleEndian(record + 8, 4);
+        uint16_t cpu = getLittleEndian(record + 12, 2);
+        if(cpu == DeltaSink::stateChangeCpu)
+        {
+            map<uint32_t, size_t>::iterator column = columns.find(p);
+            if(column == columns.end()) // the first change of a process is it joining the table
+            {
+                column = columns.insert(make_pair(p, states.size())).first;
+                states.push_back(' ');
+            }
+            states[column->second] = stateChar(State(uint8_t(record[15])));
+        }
+        else if(cpu < cpuCount)
+        {
+            tick.actions[cpu] = stepActionEnum(uint8_t(record[14]));
+            tick.processes[cpu] = p;
+        }
+    }
+    if(any) // the run ends on the last tick anything happened
+    {
+        finishTicks(time, time + 1, from, to, tick, running, states);
+    }
+
+    return 0;
+}
@@ -0,0 +1,45 @@
+// Converts a workload from the procList.txt text format to the binary format the simulator maps, see
+// workload.h. Processes without a memory column get their random memory size now, from the seed, so
+// the binary file always runs the same whatever seed the simulator is given
+//
+// usage: workloadConvert [-s|--seed seed] in.txt out.bin
+
+#include "workload.h"
+
+#include <cstdlib>
+
+int main(int argc, char* argv[])
+{
+    unsigned int seed = 0;
+    vector<string> args;
+    for(int i = 1; i < argc; i++)
+    {
+        string arg(argv[i]);
+        if((arg == "-s" || arg == "--seed") && i + 1 < argc)
+        {
+            seed = strtoul(argv[++i], nullptr, 10);
+        }
+        else
+        {
+            args.push_back(arg);
+        }
+    }
+    if(args.size() != 2)
+    {
+        cerr << "usage: " << argv[0] << " [-s|--seed seed] in.txt out.bin" << endl;
+        return 1;
+    }
+
+    Workload workload;
+    if(!readWorkloadFile(args[0], seed, workload))
+    {
+        return 1;
+    }
+    if(!writeWorkloadFile(workload, args[1]))
+    {
+        cerr << "unable to write \"" << args[1] << "\"" << endl;
+        return 1;
+    }
+    cout << workload.size() << " processes, " << workload.ioEventCount() << " IO events" << endl;
+    return 0;
+}
@@ -0,0 +1,210 @@
+// Writes a synthetic workload in the procList.txt format to stdout, one job per line:
+//   arrivalTime reqProcessorTime [memoryRequired] ioTime ioDuration ...
+//
+// usage: workloadGen [--seed n] [--jobs n] [--arrivals poisson|bursty] [--interarrival mean] [--burst mean]
+//                    [--cpu dist] [--io-gap dist] [--io-dur dist] [--mem dist]
+// where dist is one of const:v, uniform:lo:hi, exp:mean, lognormal:mu:sigma or none (--io-gap and --mem only).
+// Every job arrives on or after time step 1, IO events fall strictly inside the job's processor time and
+// without --mem the simulator picks the memory sizes itself
+
+#include <iostream>
+#include <string>
+#include <random>
+#include <cstdlib>
+#include <cmath>
+using namespace std;
+
+// A distribution of positive integers given on the command line
+struct Distribution
+{
+    enum Kind { none, constant, uniform, exponential, lognormal };
+
+    Distribution(const Kind& kind = none, const double& a = 0, const double& b = 0) : kind(kind), a(a), b(b) {}
+
+    // Parses kind:a[:b], returns false if it isn't a distribution
+    bool parse(const string& spec)
+    {
+        string name = spec.substr(0, spec.find(':'));
+        const char* pos = spec.c_str() + name.size();
+        char* end;
+        a = b = 0;
+        if(*pos == ':')
+        {
+            a = strtod(pos + 1, &end);
+            pos = end;
+        }
+        if(*pos == ':')
+        {
+            b = strtod(pos + 1, &end);
+            pos = end;
+        }
+
+        if(name == "none")
+        {
+            kind = none;
+        }
+        else if(name == "const")
+        {
+            kind = constant;
+        }
+        else if(name == "uniform")
+        {
+            kind = uniform;
+        }
+        else if(name == "exp")
+        {
+            kind = exponential;
+        }
+        else if(name == "lognormal")
+        {
+            kind = lognormal;
+        }
+        else
+        {
+            return false;
+        }
+        return *pos == '\0' && (kind != uniform || a <= b) && (kind != exponential || a > 0) && (kind != lognormal || b >= 0);
+    }
+
+    long sample(mt19937_64& rng) const
+    {
+        double v = 0;
+        switch(kind)
+        {
+            case none:
+                return 0;
+            case constant:
+                v = a;
+                break;
+            case uniform:
+                v = uniform_int_distribution<long>(llround(a), llround(b))(rng);
+                break;
+            case exponential:
+                v = exponential_distribution<double>(1.0 / a)(rng);
+                break;
+            case lognormal:
+                v = lognormal_distribution<double>(a, b)(rng);
+                break;
+        }
+        return max(1L, long(llround(v)));
+    }
+
+    Kind kind;
+    double a;
+    double b;
+};
+
+int main(int argc, char* argv[])
+{
+    unsigned long seed = 1;
+    long jobs = 1000;
+    bool bursty = false;
+    double interarrival = 10;   // mean time steps between arrivals
+    double burst = 8;           // mean jobs per burst for bursty arrivals
+    Distribution cpu(Distribution::uniform, 1, 300);
+    Distribution ioGap(Distribution::exponential, 50);  // processor time between IO requests
+    Distribution ioDuration(Distribution::uniform, 1, 60);
+    Distribution memory;
+
+    for(int i = 1; i < argc; i++)
+    {
+        string arg(argv[i]);
+        bool ok = true;
+        if(i + 1 == argc)
+        {
+            ok = false;
+        }
+        else if(arg == "--seed")
+        {
+            seed = strtoul(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--jobs")
+        {
+            jobs = strtol(argv[++i], nullptr, 10);
+        }
+        else if(arg == "--arrivals")
+        {
+            string name(argv[++i]);
+            bursty = name == "bursty";
+            ok = bursty || name == "poisson";
+        }
+        else if(arg == "--interarrival")
+        {
+            interarrival = strtod(argv[++i], nullptr);
+            ok = interarrival >= 0;
+        }
+        else if(arg == "--burst")
+        {
+            burst = strtod(argv[++i], nullptr);
+            ok = burst >= 1;
+        }
+        else if(arg == "--cpu")
+        {
+            ok = cpu.parse(argv[++i]) && cpu.kind != Distribution::none;
+        }
+        else if(arg == "--io-gap")
+        {
+            ok = ioGap.parse(argv[++i]);
+        }
+        else if(arg == "--io-dur")
+        {
+            ok = ioDuration.parse(argv[++i]) && ioDuration.kind != Distribution::none;
+        }
+        else if(arg == "--mem")
+        {
+            ok = memory.parse(argv[++i]);
+        }
+        else
+        {
+            ok = false;
+        }
+
+        if(!ok)
+        {
+            cerr << "usage: " << argv[0] << " [--seed n] [--jobs n] [--arrivals poisson|bursty] [--interarrival mean] [--burst mean]" << endl;
+            cerr << "       [--cpu dist] [--io-gap dist] [--io-dur dist] [--mem dist]" << endl;
+            cerr << "dist is const:v, uniform:lo:hi, exp:mean, lognormal:mu:sigma or none (--io-gap and --mem only)" << endl;
+            return 1;
+        }
+    }
+
+    ios::sync_with_stdio(false);
+    mt19937_64 rng(seed);
+
+    // Poisson arrivals have exponential gaps between jobs. Bursty arrivals bring a geometric number of jobs at
+    // once, with the gaps between bursts stretched to keep the same mean rate
+    exponential_distribution<double> gap(interarrival > 0 ? 1.0 / (bursty ? interarrival * burst : interarrival) : 1.0);
+    geometric_distribution<long> burstSize(1.0 / burst);
+    double arrival = 1;
+    long leftInBurst = 0;
+
+    for(long job = 0; job < jobs; job++)
+    {
+        if(!bursty || leftInBurst == 0)
+        {
+            if(job > 0 && interarrival > 0)
+            {
+                arrival += gap(rng);
+            }
+            leftInBurst = bursty ? burstSize(rng) + 1 : 1;
+        }
+        leftInBurst--;
+
+        long req = cpu.sample(rng);
+        cout << long(arrival) << ' ' << req;
+        if(memory.kind != Distribution::none)
+        {
+            cout << ' ' << memory.sample(rng);
+        }
+        if(ioGap.kind != Distribution::none)
+        {
+            for(long ioTime = ioGap.sample(rng); ioTime < req; ioTime += ioGap.sample(rng))
+            {
+                cout << ' ' << ioTime << ' ' << ioDuration.sample(rng);
+            }
+        }
+        cout << '\n';
+    }
+
+    return 0;
+}
@@ -0,0 +1,199 @@
+#include "trace.h"
+
+#include <cstring> // for memcpy
+
+bool parseOutput(const string& name, Output& output)
+{
+    if(name == "text")
+    {
+        output = textOutput;
+    }
+    else if(name == "binary")
+    {
+        output = binaryOutput;
+    }
+    else if(name == "delta")
+    {
+        output = deltaOutput;
+    }
+    else if(name == "summary")
+    {
+        output = summaryOutput;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+const char* actionLabel(const stepActionEnum& action)
+{
+    switch(action)
+    {
+        case admitNewProc:
+            return "[   admit]";
+        case handleInterrupt:
+            return "[  inrtpt]";
+        case beginRun:
+            return "[   begin]";
+        case continueRun:
+            return "[ contRun]";
+        case ioRequest:
+            return "[   ioReq]";
+        case complete:
+            return "[  finish]";
+        case noAct:
+            return "[ *noAct*]";
+        case endLevel:
+            return "[endLevel]";
+    }
+    return "";
+}
+
+void TextSink::step(const long& time, const vector<CpuStep>& steps, const vector<StateChange>& changes,
+                    const ProcessTable& procTable, const MemoryAllocator& memory)
+{
+    // slots are reused, the letters go by activation order. A run resumed from a snapshot starts with processes
+    // that already left the table, every one of them done
+    if(m_states.empty())
+    {
+        m_states.assign(procTable.results.size(), done);
+        for(uint32_t p = 0; p < procTable.size(); p++)
+        {
+            m_states[procTable.result[p]] = procTable.state[p];
+        }
+    }
+    else
+    {
+        for(size_t i = 0; i < changes.size(); i++)
+        {
+            size_t column = procTable.result[changes[i].p];
+            if(column >= m_states.size())
+            {
+                m_states.resize(column + 1);
+            }
+            m_states[column] = changes[i].to;
+        }
+    }
+
+    // Leave the below alone (at least for final submission, we are counting on the output being in expected format)
+    cout << setw(5) << time << "\t"; 
+
+    for(size_t c = 0; c < steps.size(); c++) {
+      cout << actionLabel(steps[c].action) << '\t';
+    }
+
+    // You may wish to use a second vector of processes (you don't need to, but you can)
+    printProcessStates(m_states);
+    memory.printState(procTable);
+    cout << " usedMem:" << memory.used();
+    for(size_t c = 0; c < steps.size(); c++) {
+      uint32_t runningProcess = steps[c].running;
+      if(steps.size() > 1) {cout << " cpu" << c;}
+      cout << " processlvl:";
+      if(runningProcess != noProcess) {cout << procTable.level[runningProcess] << " runningID:";}
+      if(runningProcess != noProcess) {cout << procTable.id[runningProcess] << " Mem:";}
+      if(runningProcess != noProcess) {cout << procTable.memoryRequired[runningProcess];}
+    }
+    cout << " Internal Fragmentation:" << memory.internalFragmentation();
+    if(m_showExternal) {cout << " External Fragmentation:" << memory.externalFragmentation();}
+    cout << '\n';
+}
+
+FileSink::FileSink(const string& file) : m_out(file.c_str(), ios::binary), m_buffer(1 << 22), m_used(0)
+{
+}
+
+FileSink::~FileSink()
+{
+    finish();
+}
+
+char* FileSink::append(const size_t& size)
+{
+    if(m_used + size > m_buffer.size())
+    {
+        flush();
+    }
+    char* out = &m_buffer[m_used];
+    m_used += size;
+    return out;
+}
+
+void FileSink::flush()
+{
+    m_out.write(m_buffer.data(), m_used);
+    m_used = 0;
+}
+
+void FileSink::finish()
+{
+    flush();
+    m_out.flush();
+}
+
+BinarySink::BinarySink(const string& file) : FileSink(file)
+{
+    char* header = append(16);
+    memcpy(header, "SIMTRACE", 8);
+    putLittleEndian(header + 8, version, 4);
+    putLittleEndian(header + 12, recordSize, 4);
+}
+
+void BinarySink::step(const long& time, const vector<CpuStep>& steps, const vector<StateChange>&,
+                      const ProcessTable& procTable, const MemoryAllocator& memory)
+{
+    for(size_t c = 0; c < steps.size(); c++)
+    {
+        const CpuStep& step = steps[c];
+        if(step.action == continueRun || step.action == noAct)
+        {
+            continue;
+        }
+
+        char* record = append(recordSize);
+        putLittleEndian(record, time, 8);
+        putLittleEndian(record + 8, step.process == noProcess ? noProcess : procTable.id[step.process], 4);
+        putLittleEndian(record + 12, memory.used(), 4);
+        putLittleEndian(record + 16, c, 2);
+        putLittleEndian(record + 18, step.action, 1);
+        putLittleEndian(record + 19, step.process == noProcess ? 255 : procTable.level[step.process], 1);
+    }
+}
+
+DeltaSink::DeltaSink(const string& file, const int& cpuCount) : FileSink(file)
+{
+    char* header = append(headerSize);
+    memcpy(header, "SIMDELTA", 8);
+    putLittleEndian(header + 8, version, 4);
+    putLittleEndian(header + 12, recordSize, 4);
+    putLittleEndian(header + 16, cpuCount, 4);
+}
+
+void DeltaSink::step(const long& time, const vector<CpuStep>& steps, const vector<StateChange>& changes,
+                     const ProcessTable& procTable, const MemoryAllocator&)
+{
+    for(size_t i = 0; i < changes.size(); i++)
+    {
+        char* record = append(recordSize);
+        putLittleEndian(record, time, 8);
+        putLittleEndian(record + 8, procTable.id[changes[i].p], 4);
+        putLittleEndian(record + 12, stateChangeCpu, 2);
+        putLittleEndian(record + 14, changes[i].from, 1);
+        putLittleEndian(record + 15, changes[i].to, 1);
+    }
+    for(size_t c = 0; c < steps.size(); c++)
+    {
+        if(steps[c].action == continueRun || steps[c].action == noAct)
+        {
+            continue;
+        }
+        char* record = append(recordSize);
+        putLittleEndian(record, time, 8);
+        putLittleEndian(record + 8, steps[c].process == noProcess ? noProcess : procTable.id[steps[c].process], 4);
+        putLittleEndian(record + 12, c, 2);
+        putLittleEndian(record + 14, steps[c].action, 1);
+        putLittleEndian(record + 15, 0, 1);
+    }
+}
@@ -0,0 +1,144 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include<vector>
+#include<string>
+#include<fstream>
+#include<cstdint>
+using namespace std;
+
+#include "process.h"
+#include "memory.h"
+#include "processIndex.h"
+#include "littleEndian.h"
+
+enum stepActionEnum {noAct, admitNewProc, handleInterrupt, beginRun, continueRun, ioRequest, complete, endLevel};
+
+enum Output { textOutput, binaryOutput, deltaOutput, summaryOutput };
+
+// The column an action is printed as in the per time step line
+const char* actionLabel(const stepActionEnum& action);
+
+// Parses the name of an output sink as given on the command line, returns false if it isn't one
+bool parseOutput(const string& name, Output& output);
+
+// What one processor did in a time step
+struct CpuStep
+{
+    CpuStep() : action(noAct), process(noProcess), running(noProcess) {}
+
+    stepActionEnum action;
+    uint32_t process;   // The process the action was about, e.g. the one admitted or the one that finished
+    uint32_t running;   // The process left running on the processor after the step
+};
+
+// Receives the outcome of every simulated time step. The simulation loop only fills in a CpuStep per
+// processor, how much of it gets written out and in what form is up to the sink
+class TraceSink
+{
+    public:
+      virtual ~TraceSink() {}
+
+      // changes holds the state changes made during the step, in the order they were made
+      virtual void step(const long& time, const vector<CpuStep>& steps, const vector<StateChange>& changes,
+                        const ProcessTable& procTable, const MemoryAllocator& memory) = 0;
+
+      // Called once after the last time step
+      virtual void finish() {}
+};
+
+// The original human readable line per time step, written to cout
+class TextSink : public TraceSink
+{
+    public:
+      TextSink(const bool& showExternal) : m_showExternal(showExternal) {}
+
+      void step(const long& time, const vector<CpuStep>& steps, const vector<StateChange>& changes,
+                const ProcessTable& procTable, const MemoryAllocator& memory);
+
+    private:
+      bool m_showExternal;  // Print external fragmentation too, it is always 0 or a whole partition for partitions
+      vector<State> m_states; // Every process activated so far, in that order, done ones stay on the line
+};
+
+// Base of the sinks that write fixed width records to a file. Records are gathered in a large buffer so the
+// file is written in big blocks
+class FileSink : public TraceSink
+{
+    public:
+      FileSink(const string& file);
+      ~FileSink();
+
+      bool good() const {return m_out.good();}
+
+      void finish();
+
+    protected:
+      // Room for size more bytes at the end of the buffer, to be filled in by the caller
+      char* append(const size_t& size);
+
+    private:
+      void flush();
+
+      ofstream m_out;
+      vector<char> m_buffer;
+      size_t m_used;
+};
+
+// Binary event log, only time steps where a processor did something other than carry on running or idling
+// produce records. The file starts with the 8 bytes "SIMTRACE", then the format version and the size of a
+// record as little endian uint32s, then one fixed width record per event:
+//   int64  time
+//   uint32 ID of the process the action was about, 0xFFFFFFFF for none
+//   uint32 bytes of memory in use by all resident processes after the step
+//   uint16 processor
+//   uint8  action, in stepActionEnum order
+//   uint8  level of the process, 255 for none
+// All fields are little endian
+class BinarySink : public FileSink
+{
+    public:
+      static const uint32_t version = 2;
+      static const uint32_t recordSize = 20;
+
+      BinarySink(const string& file);
+
+      void step(const long& time, const vector<CpuStep>& steps, const vector<StateChange>& changes,
+                const ProcessTable& procTable, const MemoryAllocator& memory);
+};
+
+// Delta encoded state trace, holds the state changes of the processes as they happen rather than the state
+// of every process on every time step, so its size follows the number of events and not time steps times
+// processes. Together with the actions that aren't a processor carrying on running or idling it is enough to
+// rebuild the actions and process states of any time step, see tools/traceReader. The file starts with the 8
+// bytes "SIMDELTA", then the format version, the size of a record and the number of processors as little
+// endian uint32s, then one fixed width record per event, in the order they happened:
+//   int64  time
+//   uint32 process ID, 0xFFFFFFFF for none
+//   uint16 processor that acted, or stateChangeCpu for a state change
+//   uint8  action in stepActionEnum order, or the old state of the process
+//   uint8  0 for an action, or the new state of the process
+// A process joining the process table is a state change from newArrival to newArrival. Processes join in the
+// order they are activated, so the process with the nth such change is in column n of the text trace
+class DeltaSink : public FileSink
+{
+    public:
+      static const uint32_t version = 2;
+      static const uint32_t recordSize = 16;
+      static const uint32_t headerSize = 20;
+      static const uint16_t stateChangeCpu = 0xFFFF;
+
+      DeltaSink(const string& file, const int& cpuCount);
+
+      void step(const long& time, const vector<CpuStep>& steps, const vector<StateChange>& changes,
+                const ProcessTable& procTable, const MemoryAllocator& memory);
+};
+
+// Writes nothing per time step, only the end of run summaries are printed
+class SummarySink : public TraceSink
+{
+    public:
+      void step(const long&, const vector<CpuStep>&, const vector<StateChange>&, const ProcessTable&, const MemoryAllocator&) {}
+};
+
+#endif
@@ -0,0 +1,368 @@
+#include "workload.h"
+
+#include <algorithm>  //for sort
+#include <cstdlib>    //for strtol
+#include <cstring>    //for memcpy
+#include <cstddef>    //for offsetof
+#include <random>
+#include <fstream>
+#include <iostream>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// The IO events of a mapped file are used in place
+static_assert(sizeof(IOEvent) == 24 && offsetof(IOEvent, id) == 0 && offsetof(IOEvent, device) == 4 && offsetof(IOEvent, time) == 8
+              && offsetof(IOEvent, duration) == 16, "IOEvent has to be laid out like the IO events of a binary workload");
+
+void Workload::assign(vector<Process>& processes, vector<IOEvent>& ioEvents, vector<uint32_t>& drawn)
+{
+    unmap();
+    m_processes.swap(processes);
+    m_ioEvents.swap(ioEvents);
+    m_drawn.swap(drawn);
+    m_count = m_processes.size();
+    m_events = m_ioEvents.data();
+    m_eventCount = m_ioEvents.size();
+}
+
+void Workload::redraw(const Workload& other, const unsigned int& seed)
+{
+    unmap();
+    m_processes = other.m_processes;
+    m_ioEvents.clear();
+    m_drawn = other.m_drawn;
+    m_count = other.m_count;
+    m_events = other.m_events;
+    m_eventCount = other.m_eventCount;
+
+    mt19937 rng(seed); // as readWorkloadFile draws them
+    for(size_t i = 0; i < m_drawn.size(); i++)
+    {
+        m_processes[m_drawn[i]].memoryRequired = (rng() + 1) % 256;
+    }
+}
+
+bool Workload::map(const string& fname)
+{
+    uint16_t one = 1;
+    if(*reinterpret_cast<const char*>(&one) != 1)
+    {
+        cerr << "binary workloads can only be mapped on a little endian host" << endl;
+        return false;
+    }
+
+    int fd = open(fname.c_str(), O_RDONLY);
+    if(fd == -1)
+    {
+        cerr << "unable to open workload file \"" << fname << "\"" << endl;
+        return false;
+    }
+    struct stat info;
+    if(fstat(fd, &info) != 0 || size_t(info.st_size) < headerSize)
+    {
+        close(fd);
+        cerr << "\"" << fname << "\" is not a binary workload" << endl;
+        return false;
+    }
+    size_t mapSize = info.st_size;
+    void* mapped = mmap(nullptr, mapSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file open
+    if(mapped == MAP_FAILED)
+    {
+        cerr << "unable to map workload file \"" << fname << "\"" << endl;
+        return false;
+    }
+
+    // only the header is checked up front, anything more would read the whole file
+    const char* data = static_cast<const char*>(mapped);
+    uint64_t count = getLittleEndian(data + 24, 8);
+    uint64_t eventCount = getLittleEndian(data + 32, 8);
+    uint64_t recordsAt = getLittleEndian(data + 40, 8);
+    uint64_t eventsAt = getLittleEndian(data + 48, 8);
+    if(memcmp(data, "SIMWORKL", 8) != 0 || getLittleEndian(data + 8, 4) != version
+       || getLittleEndian(data + 12, 4) != processRecordSize || getLittleEndian(data + 16, 4) != ioEventSize
+       || recordsAt > mapSize || count > (mapSize - recordsAt) / processRecordSize
+       || eventsAt > mapSize || eventCount > (mapSize - eventsAt) / ioEventSize || eventsAt % 8 != 0)
+    {
+        munmap(mapped, mapSize);
+        cerr << "\"" << fname << "\" is not a binary workload this version can read" << endl;
+        return false;
+    }
+
+    unmap();
+    m_processes.clear();
+    m_ioEvents.clear();
+    m_drawn.clear();
+    m_map = data;
+    m_mapSize = mapSize;
+    m_records = data + recordsAt;
+    m_eventsAt = eventsAt;
+    m_count = count;
+    m_events = reinterpret_cast<const IOEvent*>(data + eventsAt);
+    m_eventCount = eventCount;
+
+    // the records are read front to back as processes arrive, so the kernel can read ahead and drop what's behind
+    madvise(mapped, eventsAt, MADV_SEQUENTIAL);
+    return true;
+}
+
+void Workload::release(const size_t& from, const size_t& to) const
+{
+    if(m_map == nullptr || from >= to)
+    {
+        return;
+    }
+
+    // only whole pages, the ones at either end may hold processes that are still running
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+    size_t eventsFrom = process(from).ioBegin;
+    size_t eventsTo = to < m_count ? process(to).ioBegin : m_eventCount;
+    const char* ranges[2][2] = {{m_records + from * processRecordSize, m_records + to * processRecordSize},
+                                {m_map + m_eventsAt + eventsFrom * ioEventSize, m_map + m_eventsAt + eventsTo * ioEventSize}};
+    for(int r = 0; r < 2; r++)
+    {
+        uintptr_t begin = (reinterpret_cast<uintptr_t>(ranges[r][0]) + page - 1) / page * page;
+        uintptr_t end = reinterpret_cast<uintptr_t>(ranges[r][1]) / page * page;
+        if(begin < end)
+        {
+            madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+        }
+    }
+}
+
+void Workload::unmap()
+{
+    if(m_map != nullptr)
+    {
+        munmap(const_cast<char*>(m_map), m_mapSize);
+        m_map = nullptr;
+        m_records = nullptr;
+        m_eventsAt = 0;
+        m_mapSize = 0;
+        m_count = 0;
+        m_events = nullptr;
+        m_eventCount = 0;
+    }
+}
+
+// Reads the process on one line of a text workload into proc and appends its IO events to ioEvents, sorted by
+// time. The IDs are handed out from procID and ioID. fields and devices are room to work in. Returns false if the
+// line doesn't hold a process
+static bool parseProcessLine(const string& line, vector<long>& fields, vector<unsigned int>& devices, mt19937& rng,
+                             unsigned int& procID, unsigned int& ioID, Process& proc, vector<IOEvent>& ioEvents)
+{
+    // pull the numbers straight off the line, each with the device after an @ if there is one, reading stops at the
+    // first thing that isn't one
+    fields.clear();
+    devices.clear();
+    const char* pos = line.c_str();
+    char* end;
+    for(long val = strtol(pos, &end, 10); end != pos; val = strtol(pos, &end, 10))
+    {
+        fields.push_back(val);
+        devices.push_back(0);
+        pos = end;
+        if(*pos == '@')
+        {
+            devices.back() = strtoul(pos + 1, &end, 10);
+            if(end == pos + 1)
+            {
+                break;
+            }
+            pos = end;
+        }
+    }
+
+    if(fields.size() < 2)
+    {
+        return false; // blank line
+    }
+
+    proc.id = procID;
+    ++procID;
+
+    proc.arrivalTime = fields[0];
+    proc.reqProcessorTime = fields[1];
+
+    size_t ioField = 2;
+    if(fields.size() % 2 == 1)
+    {
+        proc.memoryRequired = fields[2];
+        ++ioField;
+    }
+    else
+    {
+        proc.memoryRequired = (rng() + 1) % 256;
+    }
+
+    proc.ioBegin = ioEvents.size();
+    for(; ioField + 1 < fields.size(); ioField += 2)
+    {
+        ioEvents.push_back(IOEvent(fields[ioField], fields[ioField + 1], ioID, devices[ioField + 1]));
+        ++ioID;
+    }
+    proc.ioEnd = ioEvents.size();
+    if(!is_sorted(ioEvents.begin() + proc.ioBegin, ioEvents.end(), ioComp))
+    {
+        stable_sort(ioEvents.begin() + proc.ioBegin, ioEvents.end(), ioComp); // takes a buffer every call
+    }
+    return true;
+}
+
+bool readWorkloadFile(const string& fname, const unsigned int& seed, Workload& workload)
+{
+    vector<char> buffer(1 << 20);
+    ifstream in;
+    string line;
+    vector<long> fields;
+    vector<unsigned int> devices;
+    Process proc;
+    unsigned int ioIDctrl(0), procIDctrl(0);
+    mt19937 rng(seed);
+
+    vector<Process> processes;
+    vector<IOEvent> ioEvents;
+    vector<uint32_t> drawnIDs; // processes without a memoryRequired column, which are all that use rng
+
+    in.rdbuf()->pubsetbuf(buffer.data(), buffer.size());
+    in.open(fname.c_str());
+    if(!in.good())
+    {
+        cerr << "initProcessSetFromFile error     unable to open file \"" << fname << "\"" << endl;
+        return false;
+    }
+
+    processes.reserve(20);
+
+    while(getline(in, line))
+    {
+        if(parseProcessLine(line, fields, devices, rng, procIDctrl, ioIDctrl, proc, ioEvents))
+        {
+            processes.push_back(proc);
+            if(fields.size() % 2 == 0)
+            {
+                drawnIDs.push_back(proc.id);
+            }
+        }
+    }
+
+    // latest arrival first, then turned around so the workload is in the order processes are let in
+    sort(processes.begin(), processes.end(), procComp);
+    reverse(processes.begin(), processes.end());
+
+    vector<uint32_t> indexOf(procIDctrl);
+    for(size_t i = 0; i < processes.size(); i++)
+    {
+        indexOf[processes[i].id] = i;
+    }
+    for(size_t i = 0; i < drawnIDs.size(); i++)
+    {
+        drawnIDs[i] = indexOf[drawnIDs[i]];
+    }
+    workload.assign(processes, ioEvents, drawnIDs);
+    return true;
+}
+
+ArrivalFeed::ArrivalFeed(istream& in, const unsigned int& seed, const unsigned int& firstID, const unsigned int& firstIOEventID) :
+    m_in(in), m_rng(seed), m_procID(firstID), m_ioID(firstIOEventID), m_ahead(false)
+{
+}
+
+bool ArrivalFeed::peek(long& arrivalTime)
+{
+    while(!m_ahead && getline(m_in, m_line))
+    {
+        m_ioEvents.clear();
+        m_ahead = parseProcessLine(m_line, m_fields, m_devices, m_rng, m_procID, m_ioID, m_proc, m_ioEvents);
+    }
+    if(m_ahead)
+    {
+        arrivalTime = m_proc.arrivalTime;
+    }
+    return m_ahead;
+}
+
+void ArrivalFeed::take(Process& proc, vector<IOEvent>& ioEvents)
+{
+    proc = m_proc;
+    ioEvents.swap(m_ioEvents);
+    m_ahead = false;
+}
+
+bool openWorkloadFile(const string& fname, const unsigned int& seed, Workload& workload)
+{
+    char magic[8] = {};
+    ifstream in(fname.c_str(), ios::binary);
+    in.read(magic, sizeof(magic));
+    if(in.gcount() == sizeof(magic) && memcmp(magic, "SIMWORKL", 8) == 0)
+    {
+        return workload.map(fname);
+    }
+    return readWorkloadFile(fname, seed, workload);
+}
+
+bool writeWorkloadFile(const Workload& workload, const string& fname)
+{
+    ofstream out(fname.c_str(), ios::binary);
+    if(!out.good())
+    {
+        return false;
+    }
+
+    // the IO events are written again grouped in process order, so a mapped run reads them roughly front to back
+    uint64_t recordsAt = Workload::headerSize;
+    uint64_t eventsAt = recordsAt + uint64_t(workload.size()) * Workload::processRecordSize;
+    uint64_t eventCount = 0;
+    for(size_t i = 0; i < workload.size(); i++)
+    {
+        Process proc = workload.process(i);
+        eventCount += proc.ioEnd - proc.ioBegin;
+    }
+
+    char header[Workload::headerSize] = {};
+    memcpy(header, "SIMWORKL", 8);
+    putLittleEndian(header + 8, Workload::version, 4);
+    putLittleEndian(header + 12, Workload::processRecordSize, 4);
+    putLittleEndian(header + 16, Workload::ioEventSize, 4);
+    putLittleEndian(header + 24, workload.size(), 8);
+    putLittleEndian(header + 32, eventCount, 8);
+    putLittleEndian(header + 40, recordsAt, 8);
+    putLittleEndian(header + 48, eventsAt, 8);
+    out.write(header, sizeof(header));
+
+    uint64_t next = 0;
+    char record[Workload::processRecordSize];
+    for(size_t i = 0; i < workload.size(); i++)
+    {
+        Process proc = workload.process(i);
+        putLittleEndian(record, proc.arrivalTime, 8);
+        putLittleEndian(record + 8, proc.reqProcessorTime, 8);
+        putLittleEndian(record + 16, proc.id, 4);
+        putLittleEndian(record + 20, uint32_t(proc.memoryRequired), 4);
+        putLittleEndian(record + 24, next, 4);
+        next += proc.ioEnd - proc.ioBegin;
+        putLittleEndian(record + 28, next, 4);
+        out.write(record, sizeof(record));
+    }
+
+    char event[Workload::ioEventSize] = {};
+    for(size_t i = 0; i < workload.size(); i++)
+    {
+        Process proc = workload.process(i);
+        for(unsigned int e = proc.ioBegin; e < proc.ioEnd; e++)
+        {
+            const IOEvent& ioEvent = workload.ioEvents()[e];
+            putLittleEndian(event, ioEvent.id, 4);
+            putLittleEndian(event + 4, ioEvent.device, 4);
+            putLittleEndian(event + 8, ioEvent.time, 8);
+            putLittleEndian(event + 16, ioEvent.duration, 8);
+            out.write(event, sizeof(event));
+        }
+    }
+
+    out.close();
+    return !out.fail();
+}
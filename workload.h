@@ -0,0 +1,191 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include<vector>
+#include<string>
+#include<cstdint>
+#include<istream>
+#include<random>
+using namespace std;
+
+#include "process.h"
+#include "littleEndian.h"
+
+inline bool procComp(const Process& p1, const Process& p2)
+{
+    return p1.arrivalTime > p2.arrivalTime;
+}
+
+inline bool ioComp(const IOEvent& e1, const IOEvent& e2)
+{
+    return e1.time < e2.time;
+}
+
+/*
+
+Binary workload files, written by tools/workloadConvert and mapped rather than read. All numbers are little endian
+
+  header, 64 bytes
+    char[8]   "SIMWORKL"
+    uint32    version, 1
+    uint32    process record size, 32
+    uint32    IO event record size, 24
+    uint32    0
+    uint64    process count
+    uint64    IO event count
+    uint64    offset of the process records
+    uint64    offset of the IO events
+    then zeros up to 64 bytes
+
+  process record, 32 bytes each, in the order the processes are activated
+    int64     arrival time
+    int64     required processor time
+    uint32    process ID
+    int32     memory required
+    uint32    first IO event of the process
+    uint32    one past its last IO event
+
+  IO event, 24 bytes each, grouped by process in the order of the process records and sorted by time within
+  a process. Laid out like IOEvent on a 64 bit little endian host so the array is used where it is mapped
+    uint32    IO event ID
+    uint32    device, 0 unless the workload names one
+    int64     time into the process execution
+    int64     duration
+
+*/
+
+// The processes of a run in the order they arrive, and the IO events of all of them. A workload is either read
+// from a text file into memory or mapped from a binary one. A mapped process is only decoded when it is
+// activated, so starting up costs nothing and only the pages of the file around the processes that have
+// arrived are resident. Nothing in a simulation writes to it, so any number of simulations can run over one
+// workload at the same time
+class Workload
+{
+    public:
+      Workload() : m_map(nullptr), m_mapSize(0), m_records(nullptr), m_eventsAt(0), m_count(0), m_events(nullptr), m_eventCount(0) {}
+      ~Workload() {unmap();}
+
+      Workload(const Workload&) = delete;
+      Workload& operator=(const Workload&) = delete;
+
+      // Takes over processes, in the order they arrive, and the IO events they refer to. drawn are the processes,
+      // by their place in processes, whose memoryRequired was drawn at random, in the order it was drawn
+      void assign(vector<Process>& processes, vector<IOEvent>& ioEvents, vector<uint32_t>& drawn);
+
+      // Makes this the workload other would have been with seed instead of the one it was read with: the
+      // memoryRequired other drew at random is drawn again, everything else is other's. The IO events aren't
+      // copied, this uses other's, so other has to outlive it
+      void redraw(const Workload& other, const unsigned int& seed);
+
+      // Whether the seed makes any difference, i.e. some memoryRequired was drawn at random
+      bool seeded() const {return !m_drawn.empty();}
+
+      // Maps a binary workload file, returns false if it can't be read or isn't one
+      bool map(const string& fname);
+
+      size_t size() const {return m_count;}
+
+      // Process i in arrival order
+      inline Process process(const size_t& i) const
+      {
+        if(m_records == nullptr) {
+          return m_processes[i];
+        }
+
+        const char* record = m_records + i * processRecordSize;
+        Process proc;
+        proc.arrivalTime = int64_t(getLittleEndian(record, 8));
+        proc.reqProcessorTime = int64_t(getLittleEndian(record + 8, 8));
+        proc.id = getLittleEndian(record + 16, 4);
+        proc.memoryRequired = int32_t(getLittleEndian(record + 20, 4));
+        proc.ioBegin = getLittleEndian(record + 24, 4);
+        proc.ioEnd = getLittleEndian(record + 28, 4);
+        if(proc.ioBegin > proc.ioEnd || proc.ioEnd > m_eventCount) { // a damaged record can't send a run outside the file
+          proc.ioBegin = proc.ioEnd = 0;
+        }
+        return proc;
+      }
+
+      inline long arrivalTime(const size_t& i) const
+      {
+        return m_records == nullptr ? m_processes[i].arrivalTime : int64_t(getLittleEndian(m_records + i * processRecordSize, 8));
+      }
+
+      const IOEvent* ioEvents() const {return m_events;}
+      size_t ioEventCount() const {return m_eventCount;}
+
+      // Lets the kernel drop the mapped pages that only hold processes [from, to) and their IO events, for when
+      // they are all done. They are read back from the file if anything touches them again, so other runs over
+      // the same workload aren't affected. Does nothing for a workload read from text
+      void release(const size_t& from, const size_t& to) const;
+
+      static const uint32_t version = 1;
+      static const uint32_t headerSize = 64;
+      static const uint32_t processRecordSize = 32;
+      static const uint32_t ioEventSize = 24;
+
+    private:
+      void unmap();
+
+      vector<Process> m_processes;  // Read from a text file
+      vector<IOEvent> m_ioEvents;
+      vector<uint32_t> m_drawn;     // See assign
+
+      const char* m_map;            // Mapped from a binary file
+      size_t m_mapSize;
+      const char* m_records;
+      uint64_t m_eventsAt;          // Offset of the IO events in the file
+
+      size_t m_count;
+      const IOEvent* m_events;
+      size_t m_eventCount;
+};
+
+// Each line is "arrivalTime reqProcessorTime [memoryRequired] [ioTime ioDuration[@device]]...", the optional
+// memoryRequired column is recognised by the odd number of fields after reqProcessorTime. An IO event without a
+// device goes to device 0, devices are numbered in the order they are configured, see --device. Processes
+// without it are given a random memoryRequired, the same seed gives the same workload every time.
+// Returns false if the file can't be read
+bool readWorkloadFile(const string& fname, const unsigned int& seed, Workload& workload);
+
+// Processes read a line at a time, in the text format, from a stream that is still being written, e.g. a pipe
+// from a generator. A line is only read once the simulation needs to know when the next process arrives, so the
+// writer only has to stay ahead of the run rather than finish first. Lines are expected in arrival order, one
+// that arrives before the line ahead of it is let in as soon as it's read
+class ArrivalFeed
+{
+    public:
+      // Processes are given IDs from firstID and IO events from firstIOEventID, so they don't clash with a workload's
+      ArrivalFeed(istream& in, const unsigned int& seed, const unsigned int& firstID, const unsigned int& firstIOEventID);
+
+      ArrivalFeed(const ArrivalFeed&) = delete;
+      ArrivalFeed& operator=(const ArrivalFeed&) = delete;
+
+      // Gives the arrival time of the next process, reading up to it if it hasn't been yet, which waits for the
+      // writer. Returns false once the stream has ended
+      bool peek(long& arrivalTime);
+
+      // Hands over the next process and its IO events, only valid after peek returned true
+      void take(Process& proc, vector<IOEvent>& ioEvents);
+
+    private:
+      istream& m_in;
+      mt19937 m_rng;            // memoryRequired for lines without one
+      unsigned int m_procID;
+      unsigned int m_ioID;
+
+      bool m_ahead;             // m_proc and m_ioEvents hold the next process
+      Process m_proc;
+      vector<IOEvent> m_ioEvents;
+      string m_line;
+      vector<long> m_fields;
+      vector<unsigned int> m_devices;
+};
+
+// Maps fname if it is a binary workload and reads it as text otherwise, seed is only used for text
+bool openWorkloadFile(const string& fname, const unsigned int& seed, Workload& workload);
+
+// Writes workload in the binary format, returns false if the file can't be written
+bool writeWorkloadFile(const Workload& workload, const string& fname);
+
+#endif